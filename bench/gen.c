@@ -0,0 +1,262 @@
+/*  Generator of synthetic RV32I programs, to measure the translator on more than the tiny test cases.
+
+    Every instruction is a valid RV32I encoding the translator knows. The mix of instruction classes,
+    how registers are picked and how many branches there are and how far they jump can all be tuned.
+    Branch targets always stay inside the program. --worst writes the layout that is hardest on
+    relaxation: compressible instructions with branches all over them whose targets sit right at the
+    edge of the compressed ranges, so whether one branch fits depends on the branches it jumps over.
+
+    Usage: gen [options] <instructions> [output]
+    Options:
+      --mix=R,I,L,S,B,J,U   Weights of register ALU, immediate ALU, loads, stores, conditional branches,
+                            jumps (jal / jalr) and lui / auipc (default: 20,30,15,10,12,5,8)
+      --branches=P          Percentage of conditional branches, the other classes keep their ratios
+      --distance=N          Farthest a branch or jal jumps, in instructions (default: 64)
+      --regs=KIND           compact: mostly x8-x15 and sp, the registers compressed instructions reach,
+                            skewed: like compiled code, zero/ra/sp/a0-a5/s0-s1 first (default),
+                            uniform: any of the 32
+      --worst               Branch-heavy worst case, ignores --mix, --branches and --distance
+      --format=text|bin     32-character lines (default), or little-endian words
+      --seed=N              Seed of the generator (default: 1)
+    The output goes to stdout without a file name.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Instruction classes of --mix */
+enum { CLASS_R, CLASS_I, CLASS_LOAD, CLASS_STORE, CLASS_BRANCH, CLASS_JUMP, CLASS_UPPER, CLASS_COUNT };
+
+enum { REGS_COMPACT, REGS_SKEWED, REGS_UNIFORM };
+
+typedef struct Generator {
+	unsigned long weights[CLASS_COUNT];
+	unsigned long total;
+	long distance;
+	int regs;
+	int worst;
+	int binary;
+	uint32_t state[2];
+} Generator;
+
+/* Registers of compiled code, most used first: zero, ra, sp, s0, s1, a0 - a5 */
+static const unsigned int skewedRegisters[] = {10, 11, 2, 8, 15, 12, 1, 9, 13, 14, 0, 5, 6, 7, 18, 19};
+
+/* Two 32-bit xorshift streams, the same output for a seed on every platform */
+static uint32_t nextRandom(Generator *generator) {
+	uint32_t x = generator->state[0], y = generator->state[1];
+	generator->state[0] = y;
+	x ^= (x << 11) & 0xFFFFFFFFUL;
+	x ^= x >> 8;
+	generator->state[1] = (x ^ y ^ (y >> 19)) & 0xFFFFFFFFUL;
+	return generator->state[1];
+}
+
+static unsigned long below(Generator *generator, unsigned long limit) { return limit == 0 ? 0 : nextRandom(generator) % limit; }
+
+static unsigned int pickRegister(Generator *generator) {
+	unsigned long roll = below(generator, 100);
+	switch (generator->regs) {
+		case REGS_COMPACT:
+			/* 9 in 10 within x8 - x15, sp now and then */
+			return roll < 90 ? 8 + (unsigned int) below(generator, 8) : roll < 95 ? 2 : (unsigned int) below(generator, 32);
+		case REGS_SKEWED:
+			/* 3 in 4 from the usual suspects */
+			return roll < 75 ? skewedRegisters[below(generator, sizeof(skewedRegisters) / sizeof(skewedRegisters[0]))] : (unsigned int) below(generator, 32);
+		default:
+			return (unsigned int) below(generator, 32);
+	}
+}
+
+/* Small immediates are the rule in real code, large ones the exception */
+static long pickImmediate(Generator *generator) {
+	unsigned long roll = below(generator, 100);
+	if (roll < 60) return (long) below(generator, 64) - 32;
+	if (roll < 90) return (long) below(generator, 512) - 256;
+	return (long) below(generator, 4096) - 2048;
+}
+
+static uint32_t encodeR(unsigned int funct7, unsigned int rs2, unsigned int rs1, unsigned int funct3, unsigned int rd) {
+	return (uint32_t) funct7 << 25 | (uint32_t) rs2 << 20 | (uint32_t) rs1 << 15 | (uint32_t) funct3 << 12 | (uint32_t) rd << 7 | 0x33;
+}
+
+static uint32_t encodeI(long imm, unsigned int rs1, unsigned int funct3, unsigned int rd, unsigned int opcode) {
+	return ((uint32_t) imm & 0xFFF) << 20 | (uint32_t) rs1 << 15 | (uint32_t) funct3 << 12 | (uint32_t) rd << 7 | opcode;
+}
+
+static uint32_t encodeS(long imm, unsigned int rs2, unsigned int rs1, unsigned int funct3) {
+	uint32_t u = (uint32_t) imm & 0xFFF;
+	return (u >> 5) << 25 | (uint32_t) rs2 << 20 | (uint32_t) rs1 << 15 | (uint32_t) funct3 << 12 | (u & 0x1F) << 7 | 0x23;
+}
+
+static uint32_t encodeSB(long imm, unsigned int rs2, unsigned int rs1, unsigned int funct3) {
+	uint32_t u = (uint32_t) imm & 0x1FFF;
+	return ((u >> 12) & 1) << 31 | ((u >> 5) & 0x3F) << 25 | (uint32_t) rs2 << 20 | (uint32_t) rs1 << 15 | (uint32_t) funct3 << 12 | ((u >> 1) & 0xF) << 8 |
+	       ((u >> 11) & 1) << 7 | 0x63;
+}
+
+static uint32_t encodeUJ(long imm, unsigned int rd) {
+	uint32_t u = (uint32_t) imm & 0x1FFFFF;
+	return ((u >> 20) & 1) << 31 | ((u >> 1) & 0x3FF) << 21 | ((u >> 11) & 1) << 20 | ((u >> 12) & 0xFF) << 12 | (uint32_t) rd << 7 | 0x6F;
+}
+
+/* Byte offset of a target at most distance instructions away that stays inside [0, count) */
+static long pickOffset(Generator *generator, size_t index, size_t count, long distance, long limit) {
+	long low = -(long) index, high = (long) (count - 1 - index), steps;
+	if (low < -distance) low = -distance;
+	if (high > distance) high = distance;
+	if (low < -limit / 4) low = -limit / 4;
+	if (high > (limit - 4) / 4) high = (limit - 4) / 4;
+	steps = low + (long) below(generator, (unsigned long) (high - low + 1));
+	return 4 * steps;
+}
+
+static uint32_t generateNormal(Generator *generator, size_t index, size_t count) {
+	static const unsigned int aluFunct3[] = {0, 0, 1, 2, 3, 4, 5, 5, 6, 7};
+	static const unsigned int loadFunct3[] = {0, 1, 2, 2, 2, 4, 5};
+	static const unsigned int branchFunct3[] = {0, 0, 1, 1, 4, 5, 6, 7};
+	unsigned long roll = below(generator, generator->total);
+	unsigned int rd = pickRegister(generator), rs1 = pickRegister(generator), rs2 = pickRegister(generator), funct3;
+	int kind = 0;
+	while (roll >= generator->weights[kind]) roll -= generator->weights[kind++];
+	/* Compilers reuse the destination as the first source about half of the time (x += y) */
+	if (below(generator, 2)) rs1 = rd;
+	switch (kind) {
+		case CLASS_R: {
+			/* add / sub / sll / slt / sltu / xor / srl / sra / or / and */
+			unsigned int choice = (unsigned int) below(generator, 10);
+			funct3 = aluFunct3[choice];
+			return encodeR(choice == 1 || choice == 7 ? 0x20 : 0, rs2, rs1, funct3, rd);
+		}
+		case CLASS_I:
+			funct3 = aluFunct3[below(generator, 10)];
+			/* Shifts take a 5-bit amount, srai sets bit 30 */
+			if (funct3 == 1 || funct3 == 5) return encodeI((long) below(generator, 32) | (funct3 == 5 && below(generator, 2) ? 0x400 : 0), rs1, funct3, rd, 0x13);
+			return encodeI(pickImmediate(generator), rs1, funct3, rd, 0x13);
+		case CLASS_LOAD:
+			/* Word loads are aligned, half of them off sp */
+			funct3 = loadFunct3[below(generator, 7)];
+			return encodeI(funct3 == 2 ? 4 * (long) below(generator, 64) : pickImmediate(generator), below(generator, 2) ? 2 : rs1, funct3, rd, 0x03);
+		case CLASS_STORE:
+			funct3 = (unsigned int) below(generator, 3);
+			return encodeS(funct3 == 2 ? 4 * (long) below(generator, 64) : pickImmediate(generator), rs2, below(generator, 2) ? 2 : rs1, funct3);
+		case CLASS_BRANCH:
+			/* Comparisons with zero are the common case */
+			return encodeSB(pickOffset(generator, index, count, generator->distance, 4096), below(generator, 2) ? 0 : rs2, rs1,
+			                branchFunct3[below(generator, 8)]);
+		case CLASS_JUMP:
+			/* Calls, plain jumps and returns */
+			if (below(generator, 4) == 0) return encodeI(0, below(generator, 2) ? 1 : rs1, 0, below(generator, 2) ? 0 : 1, 0x67);
+			return encodeUJ(pickOffset(generator, index, count, generator->distance, 1 << 20), below(generator, 2));
+		default:
+			return (nextRandom(generator) & 0xFFFFF000UL) | (uint32_t) rd << 7 | (below(generator, 2) ? 0x37 : 0x17);
+	}
+}
+
+/* Compressible code with a branch every other instruction, each one jumping just about as far as its compressed form reaches */
+static uint32_t generateWorst(Generator *generator, size_t index, size_t count) {
+	long offset;
+	if (index % 2 == 0) return encodeI(1 + (long) below(generator, 31), 8 + (unsigned int) (index / 2 % 8), 0, 8 + (unsigned int) (index / 2 % 8), 0x13);
+	/* 256 bytes is 64 words while all of them are 32-bit and 128 once they are all compressed, c.j reaches 8 times as far */
+	if (index % 4 == 1) {
+		offset = 4 * (48 + (long) below(generator, 96));
+		if (below(generator, 2)) offset = -offset;
+		if ((long) index + offset / 4 < 0 || (long) index + offset / 4 >= (long) count) offset = -offset;
+		if ((long) index + offset / 4 < 0 || (long) index + offset / 4 >= (long) count) offset = 0;
+		return encodeSB(offset, 0, 8 + (unsigned int) below(generator, 8), (unsigned int) below(generator, 2));
+	}
+	offset = 4 * (384 + (long) below(generator, 768));
+	if (below(generator, 2)) offset = -offset;
+	if ((long) index + offset / 4 < 0 || (long) index + offset / 4 >= (long) count) offset = -offset;
+	if ((long) index + offset / 4 < 0 || (long) index + offset / 4 >= (long) count) offset = 0;
+	return encodeUJ(offset, 0);
+}
+
+static void writeWord(FILE *out, uint32_t word, int binary) {
+	if (binary) {
+		unsigned char bytes[4];
+		bytes[0] = (unsigned char) (word & 0xFF);
+		bytes[1] = (unsigned char) ((word >> 8) & 0xFF);
+		bytes[2] = (unsigned char) ((word >> 16) & 0xFF);
+		bytes[3] = (unsigned char) ((word >> 24) & 0xFF);
+		fwrite(bytes, 1, 4, out);
+	} else {
+		char line[34];
+		int bit;
+		for (bit = 0; bit < 32; ++bit) line[bit] = (word >> (31 - bit)) & 1 ? '1' : '0';
+		line[32] = '\n';
+		fwrite(line, 1, 33, out);
+	}
+}
+
+static int parseMix(Generator *generator, const char *text) {
+	int i;
+	char *end;
+	for (i = 0; i < CLASS_COUNT; ++i) {
+		generator->weights[i] = strtoul(text, &end, 10);
+		if (end == text || (*end != (i + 1 < CLASS_COUNT ? ',' : '\0'))) return 1;
+		text = end + 1;
+	}
+	return 0;
+}
+
+static void usage(void) {
+	fprintf(stderr, "Usage: gen [--mix=R,I,L,S,B,J,U] [--branches=P] [--distance=N] [--regs=compact|skewed|uniform] [--worst]\n");
+	fprintf(stderr, "           [--format=text|bin] [--seed=N] <instructions> [output]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	static const unsigned long defaultWeights[CLASS_COUNT] = {20, 30, 15, 10, 12, 5, 8};
+	Generator generator;
+	FILE *out = stdout;
+	const char *output;
+	size_t count, i;
+	long branches = -1;
+	unsigned long seed = 1;
+	int k;
+	memcpy(generator.weights, defaultWeights, sizeof(defaultWeights));
+	generator.distance = 64;
+	generator.regs = REGS_SKEWED;
+	generator.worst = 0;
+	generator.binary = 0;
+	/* 1. Options */
+	for (k = 1; k < argc && argv[k][0] == '-'; ++k) {
+		if (strncmp(argv[k], "--mix=", 6) == 0) {
+			if (parseMix(&generator, argv[k] + 6)) usage();
+		} else if (strncmp(argv[k], "--branches=", 11) == 0) branches = atol(argv[k] + 11);
+		else if (strncmp(argv[k], "--distance=", 11) == 0) generator.distance = atol(argv[k] + 11);
+		else if (strcmp(argv[k], "--regs=compact") == 0) generator.regs = REGS_COMPACT;
+		else if (strcmp(argv[k], "--regs=skewed") == 0) generator.regs = REGS_SKEWED;
+		else if (strcmp(argv[k], "--regs=uniform") == 0) generator.regs = REGS_UNIFORM;
+		else if (strcmp(argv[k], "--worst") == 0) generator.worst = 1;
+		else if (strcmp(argv[k], "--format=text") == 0) generator.binary = 0;
+		else if (strcmp(argv[k], "--format=bin") == 0) generator.binary = 1;
+		else if (strncmp(argv[k], "--seed=", 7) == 0) seed = strtoul(argv[k] + 7, NULL, 10);
+		else usage();
+	}
+	if (argc - k < 1 || argc - k > 2 || atol(argv[k]) < 1 || generator.distance < 1 || branches > 100) usage();
+	count = (size_t) atol(argv[k]);
+	output = k + 1 < argc ? argv[k + 1] : NULL;
+	/* 2. Branches take their share, the other classes keep their ratios */
+	if (branches >= 0) {
+		unsigned long rest = 0;
+		for (k = 0; k < CLASS_COUNT; ++k) rest += k == CLASS_BRANCH ? 0 : generator.weights[k];
+		for (k = 0; k < CLASS_COUNT; ++k) generator.weights[k] = k == CLASS_BRANCH ? 0 : generator.weights[k] * (unsigned long) (100 - branches);
+		generator.weights[CLASS_BRANCH] = (unsigned long) branches * (rest != 0 ? rest : 1);
+	}
+	generator.total = 0;
+	for (k = 0; k < CLASS_COUNT; ++k) generator.total += generator.weights[k];
+	if (generator.total == 0) usage();
+	generator.state[0] = (uint32_t) (seed * 2654435761UL + 1) & 0xFFFFFFFFUL;
+	generator.state[1] = 0x9E3779B9UL;
+	/* 3. The program */
+	if (output != NULL && (out = fopen(output, generator.binary ? "wb" : "w")) == NULL) {
+		fprintf(stderr, "gen: unable to open %s\n", output);
+		return 1;
+	}
+	for (i = 0; i < count; ++i) writeWord(out, generator.worst ? generateWorst(&generator, i, count) : generateNormal(&generator, i, count), generator.binary);
+	return fclose(out) != 0;
+}
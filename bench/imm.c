@@ -0,0 +1,89 @@
+/*  Microbenchmark of the immediate macros, one line per layout and direction.
+
+    Every macro is expanded inline, the same way the translator uses it. Each layout is first
+    checked over every immediate it can hold: gather has to undo scatter.
+
+    Usage: imm [calls]
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/imm.h"
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/* One checker and two timers per layout. BITS is the width of the immediate, MASK the bits of it the layout keeps */
+#define LAYOUT_BENCH(layout, bits, mask)                                                                                                                       \
+	static long check##layout(void) {                                                                                                                      \
+		unsigned long imm;                                                                                                                             \
+		long mismatches = 0;                                                                                                                           \
+		for (imm = 0; imm < (1UL << (bits)); ++imm) mismatches += IMM_GATHER_##layout(IMM_SCATTER_##layout(imm & (mask))) != (imm & (mask));           \
+		return mismatches;                                                                                                                             \
+	}                                                                                                                                                      \
+	static double scatter##layout(long calls, unsigned long *sink) {                                                                                       \
+		double start = now();                                                                                                                          \
+		unsigned long acc = 0;                                                                                                                         \
+		long i;                                                                                                                                        \
+		for (i = 0; i < calls; ++i) acc ^= IMM_SCATTER_##layout((unsigned long) i & (mask));                                                           \
+		*sink += acc;                                                                                                                                  \
+		return (now() - start) / (double) calls * 1e9;                                                                                                 \
+	}                                                                                                                                                      \
+	static double gather##layout(long calls, unsigned long *sink) {                                                                                        \
+		double start = now();                                                                                                                          \
+		unsigned long acc = 0;                                                                                                                         \
+		long i;                                                                                                                                        \
+		for (i = 0; i < calls; ++i) acc ^= IMM_GATHER_##layout((unsigned long) i * 2654435761UL & 0xFFFFFFFF);                                         \
+		*sink += acc;                                                                                                                                  \
+		return (now() - start) / (double) calls * 1e9;                                                                                                 \
+	}
+
+LAYOUT_BENCH(SB, 13, 0x1FFE)
+LAYOUT_BENCH(UJ, 21, 0x1FFFFE)
+LAYOUT_BENCH(CB, 9, 0x1FE)
+LAYOUT_BENCH(CJ, 12, 0xFFE)
+LAYOUT_BENCH(CLS, 5, 0x1F)
+LAYOUT_BENCH(CIL, 8, 0xFC)
+LAYOUT_BENCH(CSS, 8, 0xFC)
+LAYOUT_BENCH(CIS, 10, 0x3F0)
+LAYOUT_BENCH(CIW, 10, 0x3FC)
+LAYOUT_BENCH(CLD, 8, 0xF8)
+LAYOUT_BENCH(CILD, 9, 0x1F8)
+LAYOUT_BENCH(CSSD, 9, 0x1F8)
+
+typedef struct Layout {
+	const char *name;
+	long (*check)(void);
+	double (*scatter)(long calls, unsigned long *sink);
+	double (*gather)(long calls, unsigned long *sink);
+} Layout;
+
+static const Layout layouts[] = {{"SB", checkSB, scatterSB, gatherSB},         {"UJ", checkUJ, scatterUJ, gatherUJ},
+                                 {"CB", checkCB, scatterCB, gatherCB},         {"CJ", checkCJ, scatterCJ, gatherCJ},
+                                 {"CL/CS", checkCLS, scatterCLS, gatherCLS},   {"CIL", checkCIL, scatterCIL, gatherCIL},
+                                 {"CSS", checkCSS, scatterCSS, gatherCSS},     {"CIS", checkCIS, scatterCIS, gatherCIS},
+                                 {"CIW", checkCIW, scatterCIW, gatherCIW},     {"CLD", checkCLD, scatterCLD, gatherCLD},
+                                 {"CILD", checkCILD, scatterCILD, gatherCILD}, {"CSSD", checkCSSD, scatterCSSD, gatherCSSD}};
+
+int main(int argc, char **argv) {
+	long calls = argc > 1 ? atol(argv[1]) : 50000000, mismatches = 0;
+	unsigned long sink = 0;
+	size_t i;
+	printf("%-6s %-8s %12s\n", "layout", "macro", "ns");
+	for (i = 0; i < sizeof layouts / sizeof layouts[0]; ++i) {
+		/* 1. Gather undoes scatter on every immediate */
+		mismatches += layouts[i].check();
+		/* 2. Time both directions */
+		printf("%-6s %-8s %12.2f\n", layouts[i].name, "scatter", layouts[i].scatter(calls, &sink));
+		printf("%-6s %-8s %12.2f\n", layouts[i].name, "gather", layouts[i].gather(calls, &sink));
+	}
+	printf("mismatches: %ld (checksum %lx)\n", mismatches, sink);
+	return mismatches != 0;
+}
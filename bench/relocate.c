@@ -0,0 +1,129 @@
+/*  Benchmark of confirmAddress() on branch-dense synthetic code.
+
+    Half of the instructions are c.addi-compressible, the other half are jal / beq with
+    offsets spread over the whole program, up to the +-1 MiB range of jal. The same program
+    is relocated twice: once with the stepping walk confirmAddress() used to do
+    (O(branches * distance)), once with confirmAddress() (O(instructions)).
+    Both results must be identical.
+
+    Usage: relocate [instructions]
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/compression.h"
+#include "../src/imm.h"
+#include "../src/utils.h"
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static unsigned long encodeJal(unsigned long rd, long imm) {
+	unsigned long u = (unsigned long) imm & 0x1FFFFF;
+	return ((u >> 20) & 1) << 31 | ((u >> 1) & 0x3FF) << 21 | ((u >> 11) & 1) << 20 | ((u >> 12) & 0xFF) << 12 | rd << 7 | 0x6F;
+}
+
+static unsigned long encodeBeq(unsigned long rs1, long imm) {
+	unsigned long u = (unsigned long) imm & 0x1FFF;
+	return ((u >> 12) & 1) << 31 | ((u >> 5) & 0x3F) << 25 | rs1 << 15 | 0x0 << 12 | ((u >> 1) & 0xF) << 8 | ((u >> 11) & 1) << 7 | 0x63;
+}
+
+static long signExtend(unsigned long value, int bits) {
+	/* Two's complement of a (bits)-bit number */
+	value &= (1UL << bits) - 1;
+	return (value >> (bits - 1)) & 1 ? (long) value - (1L << bits) : (long) value;
+}
+
+static long branchOffset(uint32_t word) {
+	/* Immediate of a beq / jal, through the same decoder as the translator */
+	Instruction source;
+	parse(word, &source);
+	return source.type == SB ? signExtend(source.imm, 13) : signExtend(source.imm, 21);
+}
+
+/* The relocation confirmAddress() did before the address map: walk +-4 bytes until the offset is consumed */
+static void legacyConfirmAddress(const Program *program, long *offsets) {
+	long i, count = (long) program->count;
+	for (i = 0; i < count; ++i) {
+		long new = 0, imm, j = i;
+		offsets[i] = 0;
+		if ((program->words[i] & 0x7F) != 0x63 && (program->words[i] & 0x7F) != 0x6F) continue;
+		imm = branchOffset(program->words[i]);
+		while (imm > 0) {
+			imm -= 4;
+			++j;
+			new += (j - 1 >= count || program->types[j - 1] == NON) ? 4 : 2;
+		}
+		while (imm < 0) {
+			imm += 4;
+			--j;
+			new -= (j < 0 || program->types[j] == NON) ? 4 : 2;
+		}
+		offsets[i] = new;
+	}
+}
+
+static long relocatedOffset(const Program *program, long i) {
+	/* What confirmAddress() wrote back, read from the instruction or its compressed encoding */
+	uint32_t word = program->words[i];
+	if (program->types[i] == NON) return branchOffset(word);
+	word = program->encoded[i];
+	return program->types[i] == BEQZ || program->types[i] == BNEZ ? signExtend(IMM_GATHER_CB(word), 9)
+	                                                               : signExtend(IMM_GATHER_CJ(word), 12);
+}
+
+int main(int argc, char **argv) {
+	long count = argc > 1 ? atol(argv[1]) : 20000, i, mismatches = 0;
+	unsigned char *bytes = malloc(4 * (size_t) count);
+	long *legacyOffsets = malloc(sizeof(long) * (size_t) count);
+	Program *program;
+	double start, legacyTime, mappedTime;
+	srand(1);
+	/* 1. Generate the program */
+	for (i = 0; i < count; ++i) {
+		unsigned long word;
+		if (i % 2 == 0) {
+			word = 0x00140413; /* addi s0, s0, 1 */
+		} else {
+			/* A target anywhere in the program, as far as jal can reach */
+			long target = (long) ((double) rand() / RAND_MAX * (count - 1)), offset = 4 * (target - i);
+			if (offset > 0xFFFFC) offset = 0xFFFFC;
+			if (offset < -0x100000) offset = -0x100000;
+			word = (i % 4 == 1 || offset > 4094 || offset < -4096) ? encodeJal(i % 8 == 1 ? 1 : 0, offset) : encodeBeq(8, offset);
+		}
+		bytes[4 * i] = (unsigned char) (word & 0xFF);
+		bytes[4 * i + 1] = (unsigned char) ((word >> 8) & 0xFF);
+		bytes[4 * i + 2] = (unsigned char) ((word >> 16) & 0xFF);
+		bytes[4 * i + 3] = (unsigned char) ((word >> 24) & 0xFF);
+	}
+	program = readFromWords(bytes, 4 * (size_t) count);
+	primaryCompression(program);
+	/* 2. Relocate, the walk only reads the program so it goes first */
+	start = now();
+	legacyConfirmAddress(program, legacyOffsets);
+	legacyTime = now() - start;
+	start = now();
+	confirmAddress(program);
+	mappedTime = now() - start;
+	/* 3. Compare the new offsets */
+	for (i = 0; i < count; ++i) {
+		if ((program->words[i] & 0x7F) != 0x63 && (program->words[i] & 0x7F) != 0x6F) continue;
+		mismatches += relocatedOffset(program, i) != legacyOffsets[i];
+	}
+	printf("instructions: %ld\n", count);
+	printf("stepping walk:   %10.6f s\n", legacyTime);
+	printf("address map:     %10.6f s\n", mappedTime);
+	printf("speedup:         %10.1fx\n", mappedTime > 0 ? legacyTime / mappedTime : 0.0);
+	printf("mismatches:      %10ld\n", mismatches);
+	clearAll(program);
+	free(legacyOffsets);
+	free(bytes);
+	return mismatches != 0;
+}
@@ -0,0 +1,91 @@
+/*  Throughput of every phase of the translator on one input file, in instructions per second.
+
+    The phases run one after another exactly like translateWithOptions() runs them on a text file:
+    readFromFile(), primaryCompression(), relaxBranches(), confirmAddress() and writeToFile(),
+    the output goes to /dev/null. End-to-end is the sum of the phases.
+
+    Usage: throughput [-j N] <input .s>
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/compression.h"
+#include "../src/parallel.h"
+#include "../src/utils.h"
+
+#define PHASES 5
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double seconds, size_t count) {
+	printf("%-20s %10.4f s %12.2f Minstr/s\n", name, seconds, seconds > 0 ? (double) count / seconds / 1e6 : 0.0);
+}
+
+int main(int argc, char **argv) {
+	static const char *names[PHASES] = {"readFromFile", "primaryCompression", "relaxBranches", "confirmAddress", "writeToFile"};
+	double times[PHASES], start, total = 0;
+	FILE *in, *out;
+	Program *program;
+	size_t count, compressed = 0, i;
+	int threads = 1, first = 1, err, k;
+	/* 1. Options */
+	if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+		threads = atoi(argv[2]);
+		first = 3;
+	}
+	if (argc - first != 1 || threads < 1 || threads > MAX_THREADS) {
+		fprintf(stderr, "Usage: throughput [-j N] <input .s>\n");
+		return 2;
+	}
+	in = fopen(argv[first], "rb");
+	out = fopen("/dev/null", "w");
+	if (in == NULL || out == NULL) {
+		fprintf(stderr, "throughput: unable to open %s\n", in == NULL ? argv[first] : "/dev/null");
+		return 2;
+	}
+	/* 2. The phases, timed one by one */
+	start = now();
+	program = readFromFile(in);
+	times[0] = now() - start;
+	if (program == NULL) return 1;
+	program->threads = threads;
+	start = now();
+	err = primaryCompression(program);
+	times[1] = now() - start;
+	start = now();
+	err = err ? err : relaxBranches(program);
+	times[2] = now() - start;
+	start = now();
+	err = err ? err : confirmAddress(program);
+	times[3] = now() - start;
+	start = now();
+	err = err ? err : writeToFile(out, program);
+	times[4] = now() - start;
+	if (err) {
+		fprintf(stderr, "throughput: translation failed (%d)\n", err);
+		return 1;
+	}
+	/* 3. Report */
+	count = program->count;
+	for (i = 0; i < count; ++i) compressed += program->types[i] != NON;
+	printf("%s: %lu instructions, %.1f%% compressed, %d thread%s\n", argv[first], (unsigned long) count, count ? 100.0 * (double) compressed / (double) count : 0.0,
+	       threads, threads == 1 ? "" : "s");
+	for (k = 0; k < PHASES; ++k) {
+		report(names[k], times[k], count);
+		total += times[k];
+	}
+	report("end-to-end", total, count);
+	clearAll(program);
+	fclose(in);
+	fclose(out);
+	return 0;
+}
@@ -0,0 +1,93 @@
+/*  Client of translator --serve, a drop-in replacement for the translator command line: same options,
+    same file names, same messages. The files are opened here and handed to the server with the options,
+    so names are relative to the caller and the server reads and writes them directly.
+
+    Usage: translator-client [--socket=<socket>] [options] <input file> <output file>
+           translator-client [--socket=<socket>] --stop
+    The socket defaults to $TRANSLATOR_SOCKET.
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/server.h"
+
+static void print_usage_and_exit() {
+	printf("Usage:\n");
+	printf("Run program with translator-client [--socket=<socket>] [options] <input file> <output file>\n");
+	printf("Stop the server with translator-client [--socket=<socket>] --stop\n");
+	printf("The socket defaults to $TRANSLATOR_SOCKET, the options are those of translator\n");
+	exit(0);
+}
+
+/* Send a request, explain when nobody answers */
+static int submit(const char *socket_path, const JobRequest *request, const int *files, int fileCount, JobReply *reply) {
+	if (submitJob(socket_path, request, files, fileCount, reply) == 0) return 0;
+	printf("Error: no translation server on %s\n", socket_path);
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	const char *socket_path = getenv("TRANSLATOR_SOCKET");
+	JobRequest *request;
+	JobReply reply;
+	FILE *input, *output;
+	int files[JOB_FILES], first = 1, i, err;
+	size_t used = 0;
+
+	if (first < argc && strncmp(argv[first], "--socket=", 9) == 0) socket_path = argv[first++] + 9;
+	if (socket_path == NULL || *socket_path == '\0') print_usage_and_exit();
+	request = calloc(1, sizeof(JobRequest));
+	if (request == NULL) return 1;
+
+	if (argc - first == 1 && strcmp(argv[first], "--stop") == 0) { /* the server finishes the jobs it has */
+		request->kind = JOB_STOP;
+		err = submit(socket_path, request, NULL, 0, &reply);
+		free(request);
+		return err;
+	}
+	if (argc - first < 2 || strlen(argv[argc - 2]) >= JOB_NAME) /* need correct arguments, and a name that fits the request */
+		print_usage_and_exit();
+
+	/* Everything before the file names goes to the server as it is, the server checks it */
+	request->kind = JOB_TRANSLATE;
+	for (i = first; i < argc - 2; ++i) {
+		size_t length = strlen(argv[i]) + 1;
+		if (used + length > JOB_ARGUMENTS) print_usage_and_exit();
+		memcpy(request->arguments + used, argv[i], length);
+		used += length;
+		++request->argumentCount;
+	}
+	strcpy(request->name, argv[argc - 2]);
+
+	/* Same checks as the translator */
+	input = fopen(argv[argc - 2], "rb");
+	if (!input) {
+		printf("Error: unable to open input file: %s\n", argv[argc - 2]);
+		printf("One or more errors encountered during translation operation.\n");
+		free(request);
+		return 0;
+	}
+	output = fopen(argv[argc - 1], "w");
+	if (!output) {
+		printf("Error: unable to open output file: %s\n", argv[argc - 1]);
+		printf("One or more errors encountered during translation operation.\n");
+		fclose(input);
+		free(request);
+		return 0;
+	}
+
+	/* The server prints to our standard output, what is buffered here comes first */
+	fflush(stdout);
+	files[0] = fileno(input);
+	files[1] = fileno(output);
+	files[2] = fileno(stdout);
+	err = submit(socket_path, request, files, JOB_FILES, &reply);
+	fclose(input);
+	fclose(output);
+	free(request);
+	return err;
+}
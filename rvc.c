@@ -0,0 +1,131 @@
+/*  In-memory entry point of the translator, for programs that link it as a library.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "src/compression.h"
+#include "src/server.h"
+#include "src/utils.h"
+
+#include "rvc.h"
+
+size_t rvc_compress_bound(size_t n) { return 4 * n; }
+
+const char *rvc_strerror(int error) {
+	switch (error) {
+		case RVC_OK:
+			return "success";
+		case RVC_ERR_ARGUMENT:
+			return "invalid argument";
+		case RVC_ERR_MEMORY:
+			return "out of memory";
+		case RVC_ERR_INSTRUCTION:
+			return "unknown instruction";
+		case RVC_ERR_SPACE:
+			return "output buffer too small";
+		case RVC_ERR_SERVER:
+			return "no translation server";
+		default:
+			return "unknown error";
+	}
+}
+
+static void collectStats(const Program *program, rvc_stats *stats) {
+	size_t i;
+	/* 1. Count the compressed instructions and the branches */
+	stats->instructions = program->count;
+	stats->compressed = 0;
+	stats->branches = 0;
+	for (i = 0; i < program->count; ++i) {
+		uint32_t opcode = program->words[i] & 0x7F;
+		stats->compressed += program->types[i] != NON;
+		stats->branches += opcode == 0x63 || opcode == 0x6F;
+	}
+	/* 2. Sizes follow from the counts */
+	stats->bytes_in = 4 * program->count;
+	stats->bytes_out = stats->bytes_in - 2 * stats->compressed;
+	stats->invalid = program->invalid;
+}
+
+int rvc_compress(const uint32_t *words, size_t n, uint8_t *out, size_t *out_len, rvc_stats *stats) {
+	Program *program;
+	rvc_stats local;
+	size_t i;
+	int err = RVC_OK;
+	/* 1. Check validation */
+	if ((words == NULL && n != 0) || out_len == NULL) return RVC_ERR_ARGUMENT;
+	if (stats == NULL) stats = &local;
+	/* 2. The whole program in one arena, sized up front */
+	program = newProgram(n);
+	if (program == NULL) return RVC_ERR_MEMORY;
+	for (i = 0; i < n; ++i) appendWord(program, words[i]);
+	/* 3. Same steps as the translator */
+	if (primaryCompression(program) != 0) {
+		err = RVC_ERR_INSTRUCTION;
+	} else if (relaxBranches(program) != 0 || confirmAddress(program) != 0) {
+		clearAll(program);
+		return RVC_ERR_MEMORY;
+	}
+	collectStats(program, stats);
+	/* 4. Only a complete output is written */
+	if (err == RVC_OK) {
+		if (out == NULL || *out_len < stats->bytes_out) err = RVC_ERR_SPACE;
+		else encodeToBytes(program, out);
+		*out_len = stats->bytes_out;
+	} else {
+		*out_len = 0;
+	}
+	clearAll(program);
+	return err;
+}
+
+int rvc_compact(uint32_t *code, size_t n, size_t *new_len, uint32_t *offset_map, rvc_stats *stats) {
+	CompactResult result;
+	int err;
+	/* 1. Check validation */
+	if ((code == NULL && n != 0) || new_len == NULL) return RVC_ERR_ARGUMENT;
+	/* 2. Everything happens inside the buffer */
+	err = compactWords(code, n, offset_map, &result);
+	if (err == 1) return RVC_ERR_MEMORY;
+	err = err == 0 ? RVC_OK : RVC_ERR_INSTRUCTION;
+	*new_len = err == RVC_OK ? result.length : 0;
+	if (stats != NULL) {
+		stats->instructions = n;
+		stats->compressed = result.compressed;
+		stats->branches = result.branches;
+		stats->bytes_in = 4 * n;
+		stats->bytes_out = result.length;
+		stats->invalid = result.invalid;
+	}
+	return err;
+}
+
+int rvc_compact_shared(const char *socket_path, int fd, size_t n, int with_map, size_t *new_len, rvc_stats *stats) {
+	JobRequest *request;
+	JobReply reply;
+	int err;
+	/* 1. Check validation */
+	if (socket_path == NULL || fd < 0 || new_len == NULL) return RVC_ERR_ARGUMENT;
+	request = calloc(1, sizeof(JobRequest));
+	if (request == NULL) return RVC_ERR_MEMORY;
+	request->kind = JOB_COMPACT;
+	request->count = n;
+	request->withMap = with_map != 0;
+	/* 2. Only the descriptor travels, the server maps the file */
+	err = submitJob(socket_path, request, &fd, 1, &reply);
+	free(request);
+	if (err) return RVC_ERR_SERVER;
+	if (reply.status < 0) return RVC_ERR_ARGUMENT;
+	if (reply.status == 1) return RVC_ERR_MEMORY;
+	*new_len = reply.status == 0 ? (size_t) reply.length : 0;
+	if (stats != NULL) {
+		stats->instructions = n;
+		stats->compressed = (size_t) reply.compressed;
+		stats->branches = (size_t) reply.branches;
+		stats->bytes_in = 4 * n;
+		stats->bytes_out = (size_t) reply.length;
+		stats->invalid = (size_t) reply.invalid;
+	}
+	return reply.status == 0 ? RVC_OK : RVC_ERR_INSTRUCTION;
+}
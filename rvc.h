@@ -0,0 +1,100 @@
+#ifndef RVC_H
+#define RVC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Results of rvc_compress() */
+typedef enum rvc_error {
+	/* The output holds the compressed code */
+	RVC_OK = 0,
+	/* words or out_len is NULL */
+	RVC_ERR_ARGUMENT,
+	/* Memory cannot be allocated */
+	RVC_ERR_MEMORY,
+	/* An instruction has an unknown opcode, see rvc_stats.invalid */
+	RVC_ERR_INSTRUCTION,
+	/* out is too small (or NULL), *out_len is set to the size needed */
+	RVC_ERR_SPACE,
+	/* No translation server answers on the socket */
+	RVC_ERR_SERVER
+} rvc_error;
+
+/* What rvc_compress() has done, valid for every result but RVC_ERR_ARGUMENT and RVC_ERR_MEMORY */
+typedef struct rvc_stats {
+	/* Number of instructions read */
+	size_t instructions;
+	/* Number of them that became 16-bit */
+	size_t compressed;
+	/* Number of branches and jumps whose offset was relocated */
+	size_t branches;
+	/* Size of the input and of the output, in bytes */
+	size_t bytes_in;
+	size_t bytes_out;
+	/* Index of the first instruction with an unknown opcode, instructions if there is none */
+	size_t invalid;
+} rvc_stats;
+
+/*  int rvc_compress(const uint32_t *words, size_t n, uint8_t *out, size_t *out_len, rvc_stats *stats):
+ *
+ *  Input:
+ *      const uint32_t *words: n RV32I instructions, in host byte order, the code starts at address 0.
+ *      uint8_t *out: Receives the compressed code as little-endian 16-bit and 32-bit instructions,
+ *                    rvc_compress_bound(n) bytes are always enough. May be NULL to only ask for the size.
+ *      size_t *out_len: Size of out on input, number of bytes written (or needed) on output.
+ *      rvc_stats *stats: Receives the statistics, may be NULL.
+ *
+ *  Output:
+ *      Same code as the translator writes with --output=bin. Nothing is global, so any number of
+ *      threads may call it at the same time, and it never exits or prints.
+ *
+ *      int:
+ *          RVC_OK or one of rvc_error.
+ */
+int rvc_compress(const uint32_t *words, size_t n, uint8_t *out, size_t *out_len, rvc_stats *stats);
+
+/*  int rvc_compact(uint32_t *code, size_t n, size_t *new_len, uint32_t *offset_map, rvc_stats *stats):
+ *
+ *  Input:
+ *      uint32_t *code: n RV32I instructions, in host byte order, the code starts at address 0.
+ *      size_t *new_len: Receives the size of the compressed code in bytes.
+ *      uint32_t *offset_map: NULL, or room for n + 1 entries: receives the new byte offset of every old
+ *                            instruction, and new_len at [n]. It also makes relocation O(1) per branch.
+ *      rvc_stats *stats: Receives the statistics, may be NULL.
+ *
+ *  Output:
+ *      Same as rvc_compress(), but the compressed code replaces the instructions in the first *new_len bytes
+ *      of code (little-endian parcels). Sizes are kept in the words themselves, and addresses in offset_map
+ *      or, without it, in an index of 8 bytes per 32 instructions.
+ *
+ *      int:
+ *          RVC_OK, RVC_ERR_ARGUMENT, RVC_ERR_MEMORY or RVC_ERR_INSTRUCTION, the last two leave code untouched.
+ */
+int rvc_compact(uint32_t *code, size_t n, size_t *new_len, uint32_t *offset_map, rvc_stats *stats);
+
+/*  int rvc_compact_shared(const char *socket_path, int fd, size_t n, int with_map, size_t *new_len, rvc_stats *stats):
+ *
+ *  Input:
+ *      const char *socket_path: Socket of a running translator --serve.
+ *      int fd: Shared memory file (shm_open(), or any file that can be mapped) starting with n words, followed
+ *              by room for the n + 1 entries of the offset map if with_map is set.
+ *      size_t *new_len: Receives the size of the compressed code in bytes.
+ *      rvc_stats *stats: Receives the statistics, may be NULL.
+ *
+ *  Output:
+ *      Same as rvc_compact() on the words of the file, done by the server right in the shared pages, so
+ *      neither the words nor the result are copied. fd stays open.
+ *
+ *      int:
+ *          RVC_OK, RVC_ERR_ARGUMENT (also when the file is too small), RVC_ERR_MEMORY, RVC_ERR_INSTRUCTION or
+ *          RVC_ERR_SERVER.
+ */
+int rvc_compact_shared(const char *socket_path, int fd, size_t n, int with_map, size_t *new_len, rvc_stats *stats);
+
+/* Largest output of rvc_compress() for n instructions */
+size_t rvc_compress_bound(size_t n);
+
+/* Text of a result of rvc_compress() */
+const char *rvc_strerror(int error);
+
+#endif
@@ -1,13 +1,13 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "compression.h"
+#include "imm.h"
+#include "parallel.h"
 #include "utils.h"
 
-#define INT_MAX 2147483647
-#define INT_MIN (-INT_MAX - 1)
-
 static int powerOfTwo(const int num) {
 	/* Returns 2^(num) */
 	return 1 << (num);
@@ -20,521 +20,1083 @@ static short compressRegister(const short reg) {
 	return (short) (reg & 0x7);
 }
 
-static int parseNumber(const unsigned long imm) {
-	/* 1. This function decides whether a 12-bit number can fit into bits */
-	unsigned long a = (imm >> 11) & 1;
-	if (a == 1) {
-		/* 2. Two's complement for negative numbers */
-		return (int) -(~(imm - 1) & 0xFFF);
-	} else {
-		/* 3. Positive numbers */
-		return (int) imm;
+static long signExtend(const unsigned long imm, const int bits) {
+	/* 1. Keep the lowest (bits) bits */
+	long value = (long) (imm & ((1UL << bits) - 1));
+	/* 2. Two's complement for negative numbers */
+	if ((value >> (bits - 1)) & 1) value -= 1L << bits;
+	return value;
+}
+
+static long branchOffset(const Instruction *source) {
+	/* Branches hold a 13-bit offset, jumps a 21-bit offset */
+	return signExtend(source->imm, source->type == SB ? 13 : 21);
+}
+
+static int fitsSigned(const long value, const int bits) {
+	/* Whether value fits into a (bits)-bit two's complement number */
+	return value >= -1 * powerOfTwo(bits - 1) && value <= powerOfTwo(bits - 1) - 1;
+}
+
+/* A classifier decides which compressed instruction (if any) one opcode / funct3 pair becomes,
+ * funct7 and the operands are checked inside */
+typedef Ctype ClassifyFunction(const Instruction *source);
+
+static Ctype classifyAddSub(const Instruction *source) {
+	/* 1. c.sub, need to check whether registers can be compressed */
+	if (source->funct7 == 0x20) {
+		if (source->rd != source->rs1 || compressRegister(source->rd) == -1 || compressRegister(source->rs2) == -1) return NON;
+		return SUB;
 	}
+	/* 2. c.mul (Zcb), same registers as c.sub */
+	if (source->funct7 == 0x1) {
+		if (source->rd != source->rs1 || compressRegister(source->rd) == -1 || compressRegister(source->rs2) == -1) return NON;
+		return MUL;
+	}
+	/* 3. Other funct7 values are not add */
+	if (source->funct7 != 0x0) return NON;
+	/* 4. c.add */
+	if (source->rs1 == source->rd && source->rd != 0x0 && source->rs2 != 0x0) return ADD;
+	/* 5. c.mv */
+	if (source->rs1 == 0x0 && source->rd != 0x0 && source->rs2 != 0x0) return MV;
+	/* 6. Cannot be compressed */
+	return NON;
 }
 
-static Ctype checkR(const Instruction *source) {
-	/* 1. 4 conditions of R-type instruction can be compressed */
+static Ctype classifyLogical(const Instruction *source) {
+	/* 1. c.xor, c.or and c.and, need to check whether registers can be compressed */
+	if (source->funct7 != 0x0 || source->rd != source->rs1 || compressRegister(source->rd) == -1 || compressRegister(source->rs2) == -1) return NON;
+	/* 2. funct3 tells which one */
 	switch (source->funct3) {
-		case 0x0:
-			/* 2. c.sub, need to check whether registers can be compressed */
-			if (source->funct7 == 0x20) {
-				if (source->rd != source->rs1 || compressRegister(source->rd) == -1 || compressRegister(source->rs2) == -1) return NON;
-				return SUB;
-			} else {
-				/* 3. c.add */
-				if (source->rs1 == source->rd && source->rd != 0x0 && source->rs2 != 0x0) {
-					return ADD;
-				}
-				/* 4. c.mv */
-				else if (source->rs1 == 0x0 && source->rd != 0x0 && source->rs2 != 0x0) {
-					return MV;
-				}
-				/* 5. Cannot be compressed */
-				return NON;
-			}
 		case 0x4:
-			/* 6. c.xor, need to check whether registers can be compressed */
-			if (source->rd != source->rs1 || compressRegister(source->rd) == -1 || compressRegister(source->rs2) == -1) return NON;
 			return XOR;
 		case 0x6:
-			/* 7. c.or, need to check whether registers can be compressed */
-			if (source->rd != source->rs1 || compressRegister(source->rd) == -1 || compressRegister(source->rs2) == -1) return NON;
 			return OR;
-		case 0x7:
-			/* 8. c.and, need to check whether registers can be compressed */
-			if (source->rd != source->rs1 || compressRegister(source->rd) == -1 || compressRegister(source->rs2) == -1) return NON;
+		default:
 			return AND;
 	}
+}
+
+static Ctype classifyZextH(const Instruction *source) {
+	/* c.zext.h (Zcb), zext.h is funct7 0x04 with rs2 x0, in OP on RV32 and in OP-32 on RV64 */
+	if (source->funct7 == 0x4 && source->rs2 == 0x0 && source->rd == source->rs1 && compressRegister(source->rd) != -1) return ZEXTH;
 	return NON;
 }
 
-static Ctype checkI(const Instruction *source) {
-	/* 1. 3 conditions of I-type instruction can be compressed */
-	switch (source->opcode) {
-		case 0x67:
-			if (source->rs1 == 0 || source->imm != 0) return NON;
-			/* 2. c.jr */
-			if (source->rd == 0) return JR;
-			/* 3. c.jalr */
-			if (source->rd == 1) return JALR;
-			return NON;
-		case 0x03:
-			/* 4. c.lw */
-			if (compressRegister(source->rd) != -1 && compressRegister(source->rs1) != -1 && (parseNumber(source->imm) >= 0) &&
-			    (parseNumber(source->imm) % 4 == 0) && (parseNumber(source->imm) <= powerOfTwo(7) - 1))
-				return LW;
-			return NON;
-			/* Things are tough when coming to immediate values */
-		case 0x13:
-			switch (source->funct3) {
-				case 0x0:
-					/* 5. c.li */
-					if (source->rd != 0 && source->rs1 == 0 && (parseNumber(source->imm) >= -1 * powerOfTwo(5)) &&
-					    (parseNumber(source->imm) <= powerOfTwo(5) - 1))
-						return LI;
-					/* c.addi */
-					else if ((source->rd == source->rs1) && (source->rd != 0x0) && (source->imm != 0x0) && (parseNumber(source->imm) >= -1 * powerOfTwo(5)) &&
-					         (parseNumber(source->imm) <= powerOfTwo(5) - 1))
-						return ADDI;
-					return NON;
-				case 0x1: /*6. c.slli */
-					if (((source->rd == source->rs1) && (source->rd != 0x0))) { return SLLI; }
-					return NON;
-				case 0x5:
-					if (source->funct7 == 0x0) {
-						/* c.srli */
-						if ((compressRegister(source->rd) != -1) && (source->rs1 == source->rd)) { return SRLI; }
-						return NON;
-					} else if (source->funct7 == 0x20) {
-						/* c.srai */
-						if ((compressRegister(source->rd) != -1) && (source->rs1 == source->rd)) { return SRAI; }
-						return NON;
-					} else break;
-				case 0x7:
-					/* c.andi */
-					if ((compressRegister(source->rd) != -1) && (source->rs1 == source->rd) && (parseNumber(source->imm) >= -1 * powerOfTwo(5)) &&
-					    (parseNumber(source->imm) <= powerOfTwo(5) - 1)) {
-						return ANDI;
-					}
-					return NON;
-			}
-	}
-	/* Basically return NON to avoid returning nothing */
+static Ctype classifyXor(const Instruction *source) {
+	/* 1. On RV32 zext.h shares its funct3 with xor */
+	if (source->funct7 == 0x4) return classifyZextH(source);
+	/* 2. c.xor */
+	return classifyLogical(source);
+}
+
+static Ctype classifyJalr(const Instruction *source) {
+	if (source->rs1 == 0 || source->imm != 0) return NON;
+	/* 1. c.jr */
+	if (source->rd == 0) return JR;
+	/* 2. c.jalr */
+	if (source->rd == 1) return JALR;
 	return NON;
 }
 
-static Ctype checkU(const Instruction *source) {
-	/* The function check if the source can be compressed into LUI type */
-	if ((source->rd != 0x0 && source->rd != 0x2) && (source->imm != 0x0) && (parseNumber(source->imm >> 12) >= -1 * powerOfTwo(5)) &&
-	    (parseNumber(source->imm >> 12) <= powerOfTwo(5) - 1)) {
-		return LUI;
-	} else {
-		/* Return NON by default */
-		return NON;
-	}
+static Ctype classifyLw(const Instruction *source) {
+	long imm = signExtend(source->imm, 12);
+	if (imm < 0 || imm % 4 != 0) return NON;
+	/* 1. c.lw, a non-negative multiple of 4 below 128 */
+	if (compressRegister(source->rd) != -1 && compressRegister(source->rs1) != -1 && imm <= powerOfTwo(7) - 1) return LW;
+	/* 2. c.lwsp, any rd but x0 and a non-negative multiple of 4 below 256 */
+	if (source->rs1 == 0x2 && source->rd != 0x0 && imm <= powerOfTwo(8) - 1) return LWSP;
+	return NON;
 }
 
-static Ctype checkSB(const Instruction *source) {
-	switch (source->funct3) {
-		case 0x0: /*beq*/
-			if ((source->rs2 == 0x0 && compressRegister(source->rs1) != -1) && (parseNumber(source->imm) % 2 == 0) &&
-			    (parseNumber(source->imm) >= -1 * powerOfTwo(8)) && (parseNumber(source->imm) <= powerOfTwo(8) - 1)) {
-				return BEQZ;
-			} else {
-				/* Return NON by default */
-				return NON;
-			}
+static Ctype classifySw(const Instruction *source) {
+	long imm = signExtend(source->imm, 12);
+	if (imm < 0 || imm % 4 != 0) return NON;
+	/* 1. c.sw, a non-negative multiple of 4 below 128 */
+	if (compressRegister(source->rs1) != -1 && compressRegister(source->rs2) != -1 && imm <= powerOfTwo(7) - 1) return SW;
+	/* 2. c.swsp, any rs2 and a non-negative multiple of 4 below 256 */
+	if (source->rs1 == 0x2 && imm <= powerOfTwo(8) - 1) return SWSP;
+	return NON;
+}
 
-		case 0x1: /*bne*/
-			if ((source->rs2 == 0x0 && compressRegister(source->rs1) != -1) && (parseNumber(source->imm) % 2 == 0) &&
-			    (parseNumber(source->imm) >= -1 * powerOfTwo(8)) && (parseNumber(source->imm) <= powerOfTwo(8) - 1)) {
-				return BNEZ;
-			} else {
-				/* Return NON by default */
-				return NON;
-			}
+static Ctype classifyAddi(const Instruction *source) {
+	long imm = signExtend(source->imm, 12);
+	if (fitsSigned(imm, 6)) {
+		/* 1. c.li */
+		if (source->rd != 0 && source->rs1 == 0) return LI;
+		/* 2. c.addi */
+		if (source->rd == source->rs1 && source->rd != 0x0 && imm != 0x0) return ADDI;
 	}
-	/* Return NON by default */
+	if (source->rs1 != 0x2 || imm == 0x0) return NON;
+	/* 3. c.addi16sp, sp moves by a non-zero multiple of 16 in -512 ~ +496 */
+	if (source->rd == 0x2 && imm % 16 == 0 && fitsSigned(imm, 10)) return ADDI16SP;
+	/* 4. c.addi4spn, rd' gets sp plus a non-zero multiple of 4 below 1024 */
+	if (compressRegister(source->rd) != -1 && imm > 0 && imm % 4 == 0 && imm <= powerOfTwo(10) - 1) return ADDI4SPN;
 	return NON;
 }
 
-static Ctype checkS(const Instruction *source) {
-	/* The function check if the source can be compressed into SW type */
-	if (compressRegister(source->rs1) != -1 && (parseNumber(source->imm) >= 0) && (parseNumber(source->imm) % 4 == 0) &&
-	    (parseNumber(source->imm) <= powerOfTwo(7) - 1) && compressRegister(source->rs1) != -1 && compressRegister(source->rs2) != -1) {
-		return SW;
-	} else {
-		/* Return NON by default */
-		return NON;
-	}
+static Ctype classifySext(const Instruction *source) {
+	/* c.sext.b / c.sext.h (Zcb), both are funct7 0x30 of slli with 4 / 5 in the place of the shift amount */
+	if (source->funct7 != 0x30 || source->rd != source->rs1 || compressRegister(source->rd) == -1) return NON;
+	if (source->rs2 == 0x4) return SEXTB;
+	if (source->rs2 == 0x5) return SEXTH;
+	return NON;
 }
 
-static Ctype checkUJ(const Instruction *source) {
-	/* The function check if the source can be compressed into J / JAL type */
-	if (source->rd == 0x0 && (parseNumber(source->imm) % 2 == 0) && (parseNumber(source->imm) >= -1 * powerOfTwo(11)) &&
-	    (parseNumber(source->imm) <= powerOfTwo(11) - 1)) {
-		return J;
-		/* JAL */
-	} else if (source->rd == 0x1 && (parseNumber(source->imm) % 2 == 0) && (parseNumber(source->imm) >= -1 * powerOfTwo(11)) &&
-	           (parseNumber(source->imm) <= powerOfTwo(11) - 1)) {
-		return JAL;
-	}
-	/* Return NON by default */
+static Ctype classifySlli(const Instruction *source) {
+	/* 1. c.slli */
+	if (source->funct7 == 0x0 && source->rd == source->rs1 && source->rd != 0x0) return SLLI;
+	/* 2. The sign extensions */
+	return classifySext(source);
+}
+
+static Ctype classifyShiftRight(const Instruction *source) {
+	if (compressRegister(source->rd) == -1 || source->rs1 != source->rd) return NON;
+	/* 1. c.srli */
+	if (source->funct7 == 0x0) return SRLI;
+	/* 2. c.srai */
+	if (source->funct7 == 0x20) return SRAI;
 	return NON;
 }
 
-static Ctype assertCType(const Instruction *source) {
-	/* 1. Check validation */
-	if (source == NULL) return NON;
-	/* 2. Cannot be compressed */
-	if (source->inCompressAbleList == 0) return NON;
-	/* 3. Switch cases */
-	switch (source->type) {
-		case R:
-			return checkR(source);
-		case I: /* We should design a function for every type of instruction */
-			return checkI(source);
-		case U:
-			return checkU(source);
-		case S: /* We should design a function for every type of instruction */
-			return checkS(source);
-		case SB:
-			return checkSB(source);
-		case UJ: /* We should design a function for every type of instruction */
-			return checkUJ(source);
-	}
-	/* Return NON by default */
+static Ctype classifyAndi(const Instruction *source) {
+	if (compressRegister(source->rd) == -1 || source->rs1 != source->rd) return NON;
+	/* 1. c.andi */
+	if (fitsSigned(signExtend(source->imm, 12), 6)) return ANDI;
+	/* 2. c.zext.b (Zcb), andi with 0xff */
+	if (source->imm == 0xFF) return ZEXTB;
 	return NON;
 }
 
-/* Return -1 by default */
-static short assertOpcode(const Instruction *source) {
-	switch (assertCType(source)) {
-		case ADD:  /* CR-format */
-		case MV:   /* CR-format */
-		case JR:   /* CR-format */
-		case JALR: /* CR-format */
-		case SLLI: /* CI-format */
-			return 2;
-		case LI:   /* CI-format */
-		case LUI:  /* CI-format */
-		case ADDI: /* CI-format */
-		case AND:  /* CS-format */
-		case OR:   /* CS-format */
-		case XOR:  /* CS-format */
-		case SUB:  /* CS-format */
-		case BEQZ: /* CB-format */
-		case BNEZ: /* CB-format */
-		case SRLI: /* CB-format */
-		case SRAI: /* CB-format */
-		case ANDI: /* CB-format */
-		case J:    /* CJ-format */
-		case JAL:  /* CJ-format */
-			return 1;
-		case LW: /* CL-format */
-		case SW: /* CS-format */
-			return 0;
+static Ctype classifyNot(const Instruction *source) {
+	/* c.not (Zcb), xori with -1 */
+	if (compressRegister(source->rd) != -1 && source->rs1 == source->rd && source->imm == 0xFFF) return NOT;
+	return NON;
+}
+
+static Ctype classifyLbu(const Instruction *source) {
+	/* c.lbu (Zcb), an offset of 0 ~ 3 */
+	if (compressRegister(source->rd) != -1 && compressRegister(source->rs1) != -1 && source->imm <= 0x3) return LBU;
+	return NON;
+}
+
+static Ctype classifyLh(const Instruction *source) {
+	/* c.lh / c.lhu (Zcb), an offset of 0 or 2, funct3 1 is lh */
+	if (compressRegister(source->rd) == -1 || compressRegister(source->rs1) == -1 || (source->imm != 0x0 && source->imm != 0x2)) return NON;
+	return source->funct3 == 0x1 ? LH : LHU;
+}
+
+static Ctype classifySb(const Instruction *source) {
+	/* c.sb (Zcb), an offset of 0 ~ 3 */
+	if (compressRegister(source->rs1) != -1 && compressRegister(source->rs2) != -1 && source->imm <= 0x3) return SBYTE;
+	return NON;
+}
+
+static Ctype classifySh(const Instruction *source) {
+	/* c.sh (Zcb), an offset of 0 or 2 */
+	if (compressRegister(source->rs1) != -1 && compressRegister(source->rs2) != -1 && (source->imm == 0x0 || source->imm == 0x2)) return SHALF;
+	return NON;
+}
+
+static Ctype classifyLui(const Instruction *source) {
+	/* c.lui, a non-zero immediate that fits into 6 bits, rd is neither x0 nor x2 */
+	if (source->rd != 0x0 && source->rd != 0x2 && source->imm != 0x0 && fitsSigned(signExtend(source->imm >> 12, 20), 6)) return LUI;
+	return NON;
+}
+
+static Ctype classifyLd(const Instruction *source) {
+	long imm = signExtend(source->imm, 12);
+	if (imm < 0 || imm % 8 != 0) return NON;
+	/* 1. c.ld, a non-negative multiple of 8 below 256 */
+	if (compressRegister(source->rd) != -1 && compressRegister(source->rs1) != -1 && imm <= powerOfTwo(8) - 1) return LD;
+	/* 2. c.ldsp, any rd but x0 and a non-negative multiple of 8 below 512 */
+	if (source->rs1 == 0x2 && source->rd != 0x0 && imm <= powerOfTwo(9) - 1) return LDSP;
+	return NON;
+}
+
+static Ctype classifySd(const Instruction *source) {
+	long imm = signExtend(source->imm, 12);
+	if (imm < 0 || imm % 8 != 0) return NON;
+	/* 1. c.sd, a non-negative multiple of 8 below 256 */
+	if (compressRegister(source->rs1) != -1 && compressRegister(source->rs2) != -1 && imm <= powerOfTwo(8) - 1) return SD;
+	/* 2. c.sdsp, any rs2 and a non-negative multiple of 8 below 512 */
+	if (source->rs1 == 0x2 && imm <= powerOfTwo(9) - 1) return SDSP;
+	return NON;
+}
+
+static Ctype classifySlli64(const Instruction *source) {
+	/* 1. c.slli, RV64 shifts by up to 63 so only the upper 6 bits of funct7 are 0 */
+	if ((source->funct7 >> 1) == 0x0 && source->rd == source->rs1 && source->rd != 0x0) return SLLI;
+	/* 2. The sign extensions */
+	return classifySext(source);
+}
+
+static Ctype classifyShiftRight64(const Instruction *source) {
+	if (compressRegister(source->rd) == -1 || source->rs1 != source->rd) return NON;
+	/* 1. c.srli */
+	if ((source->funct7 >> 1) == 0x0) return SRLI;
+	/* 2. c.srai */
+	if ((source->funct7 >> 1) == 0x10) return SRAI;
+	return NON;
+}
+
+static Ctype classifyAddiw(const Instruction *source) {
+	/* c.addiw, unlike c.addi the immediate may be 0 (sext.w) */
+	if (source->rd == source->rs1 && source->rd != 0x0 && fitsSigned(signExtend(source->imm, 12), 6)) return ADDIW;
+	return NON;
+}
+
+static Ctype classifyAddSubW(const Instruction *source) {
+	if (source->rd != source->rs1 || compressRegister(source->rd) == -1) return NON;
+	/* 1. c.zext.w (Zcb), add.uw with rs2 x0 */
+	if (source->funct7 == 0x4 && source->rs2 == 0x0) return ZEXTW;
+	if (compressRegister(source->rs2) == -1) return NON;
+	/* 2. c.addw */
+	if (source->funct7 == 0x0) return ADDW;
+	/* 3. c.subw */
+	if (source->funct7 == 0x20) return SUBW;
+	return NON;
+}
+
+static Ctype classifyFlw(const Instruction *source) {
+	long imm = signExtend(source->imm, 12);
+	if (imm < 0 || imm % 4 != 0) return NON;
+	/* 1. c.flw, the offsets of c.lw */
+	if (compressRegister(source->rd) != -1 && compressRegister(source->rs1) != -1 && imm <= powerOfTwo(7) - 1) return FLW;
+	/* 2. c.flwsp, the offsets of c.lwsp, and f0 is allowed */
+	if (source->rs1 == 0x2 && imm <= powerOfTwo(8) - 1) return FLWSP;
+	return NON;
+}
+
+static Ctype classifyFsw(const Instruction *source) {
+	long imm = signExtend(source->imm, 12);
+	if (imm < 0 || imm % 4 != 0) return NON;
+	/* 1. c.fsw, the offsets of c.sw */
+	if (compressRegister(source->rs1) != -1 && compressRegister(source->rs2) != -1 && imm <= powerOfTwo(7) - 1) return FSW;
+	/* 2. c.fswsp, the offsets of c.swsp */
+	if (source->rs1 == 0x2 && imm <= powerOfTwo(8) - 1) return FSWSP;
+	return NON;
+}
+
+static Ctype classifyFld(const Instruction *source) {
+	long imm = signExtend(source->imm, 12);
+	if (imm < 0 || imm % 8 != 0) return NON;
+	/* 1. c.fld, the offsets of c.ld */
+	if (compressRegister(source->rd) != -1 && compressRegister(source->rs1) != -1 && imm <= powerOfTwo(8) - 1) return FLD;
+	/* 2. c.fldsp, the offsets of c.ldsp, and f0 is allowed */
+	if (source->rs1 == 0x2 && imm <= powerOfTwo(9) - 1) return FLDSP;
+	return NON;
+}
+
+static Ctype classifyFsd(const Instruction *source) {
+	long imm = signExtend(source->imm, 12);
+	if (imm < 0 || imm % 8 != 0) return NON;
+	/* 1. c.fsd, the offsets of c.sd */
+	if (compressRegister(source->rs1) != -1 && compressRegister(source->rs2) != -1 && imm <= powerOfTwo(8) - 1) return FSD;
+	/* 2. c.fsdsp, the offsets of c.sdsp */
+	if (source->rs1 == 0x2 && imm <= powerOfTwo(9) - 1) return FSDSP;
+	return NON;
+}
+
+static Ctype classifyBranch(const Instruction *source) {
+	/* c.beqz / c.bnez compare rs1' with zero, and reach -256 ~ +254 bytes */
+	if (source->rs2 != 0x0 || compressRegister(source->rs1) == -1 || !fitsSigned(branchOffset(source), 9)) return NON;
+	return source->funct3 == 0x0 ? BEQZ : BNEZ;
+}
+
+static Ctype classifyJal(const Instruction *source) {
+	/* c.j / c.jal reach -2048 ~ +2046 bytes */
+	if (!fitsSigned(branchOffset(source), 12)) return NON;
+	if (source->rd == 0x0) return J;
+	if (source->rd == 0x1) return JAL;
+	return NON;
+}
+
+static Ctype classifyJal64(const Instruction *source) {
+	/* RV64 has c.addiw in the place of c.jal, only c.j is left */
+	if (source->rd == 0x0 && fitsSigned(branchOffset(source), 12)) return J;
+	return NON;
+}
+
+/* Decode table: one row per major opcode (opcode >> 2), one column per funct3 */
+#define NO_RULE 0, 0, 0, 0, 0, 0, 0, 0
+static ClassifyFunction *const classifiers[32][8] = {
+        /* 0x03 LOAD */ {0, classifyLh, classifyLw, 0, classifyLbu, classifyLh, 0, 0},
+        /* 0x07 LOAD-FP */ {0, 0, classifyFlw, classifyFld, 0, 0, 0, 0},
+        /* 0x0B */ {NO_RULE},
+        /* 0x0F */ {NO_RULE},
+        /* 0x13 OP-IMM */ {classifyAddi, classifySlli, 0, 0, classifyNot, classifyShiftRight, 0, classifyAndi},
+        /* 0x17 */ {NO_RULE},
+        /* 0x1B */ {NO_RULE},
+        /* 0x1F */ {NO_RULE},
+        /* 0x23 STORE */ {classifySb, classifySh, classifySw, 0, 0, 0, 0, 0},
+        /* 0x27 STORE-FP */ {0, 0, classifyFsw, classifyFsd, 0, 0, 0, 0},
+        /* 0x2B */ {NO_RULE},
+        /* 0x2F */ {NO_RULE},
+        /* 0x33 OP */ {classifyAddSub, 0, 0, 0, classifyXor, 0, classifyLogical, classifyLogical},
+        /* 0x37 LUI */ {classifyLui, classifyLui, classifyLui, classifyLui, classifyLui, classifyLui, classifyLui, classifyLui},
+        /* 0x3B */ {NO_RULE},
+        /* 0x3F */ {NO_RULE},
+        /* 0x43 */ {NO_RULE},
+        /* 0x47 */ {NO_RULE},
+        /* 0x4B */ {NO_RULE},
+        /* 0x4F */ {NO_RULE},
+        /* 0x53 */ {NO_RULE},
+        /* 0x57 */ {NO_RULE},
+        /* 0x5B */ {NO_RULE},
+        /* 0x5F */ {NO_RULE},
+        /* 0x63 BRANCH */ {classifyBranch, classifyBranch, 0, 0, 0, 0, 0, 0},
+        /* 0x67 JALR */ {classifyJalr, 0, 0, 0, 0, 0, 0, 0},
+        /* 0x6B */ {NO_RULE},
+        /* 0x6F JAL */ {classifyJal, classifyJal, classifyJal, classifyJal, classifyJal, classifyJal, classifyJal, classifyJal},
+        /* 0x73 */ {NO_RULE},
+        /* 0x77 */ {NO_RULE},
+        /* 0x7B */ {NO_RULE},
+        /* 0x7F */ {NO_RULE}};
+
+/* Same for RV64C: doubleword loads and stores, the W instructions, 6-bit shift amounts, no c.jal and no c.flw */
+static ClassifyFunction *const classifiers64[32][8] = {
+        /* 0x03 LOAD */ {0, classifyLh, classifyLw, classifyLd, classifyLbu, classifyLh, 0, 0},
+        /* 0x07 LOAD-FP */ {0, 0, 0, classifyFld, 0, 0, 0, 0},
+        /* 0x0B */ {NO_RULE},
+        /* 0x0F */ {NO_RULE},
+        /* 0x13 OP-IMM */ {classifyAddi, classifySlli64, 0, 0, classifyNot, classifyShiftRight64, 0, classifyAndi},
+        /* 0x17 */ {NO_RULE},
+        /* 0x1B OP-IMM-32 */ {classifyAddiw, 0, 0, 0, 0, 0, 0, 0},
+        /* 0x1F */ {NO_RULE},
+        /* 0x23 STORE */ {classifySb, classifySh, classifySw, classifySd, 0, 0, 0, 0},
+        /* 0x27 STORE-FP */ {0, 0, 0, classifyFsd, 0, 0, 0, 0},
+        /* 0x2B */ {NO_RULE},
+        /* 0x2F */ {NO_RULE},
+        /* 0x33 OP */ {classifyAddSub, 0, 0, 0, classifyLogical, 0, classifyLogical, classifyLogical},
+        /* 0x37 LUI */ {classifyLui, classifyLui, classifyLui, classifyLui, classifyLui, classifyLui, classifyLui, classifyLui},
+        /* 0x3B OP-32 */ {classifyAddSubW, 0, 0, 0, classifyZextH, 0, 0, 0},
+        /* 0x3F */ {NO_RULE},
+        /* 0x43 */ {NO_RULE},
+        /* 0x47 */ {NO_RULE},
+        /* 0x4B */ {NO_RULE},
+        /* 0x4F */ {NO_RULE},
+        /* 0x53 */ {NO_RULE},
+        /* 0x57 */ {NO_RULE},
+        /* 0x5B */ {NO_RULE},
+        /* 0x5F */ {NO_RULE},
+        /* 0x63 BRANCH */ {classifyBranch, classifyBranch, 0, 0, 0, 0, 0, 0},
+        /* 0x67 JALR */ {classifyJalr, 0, 0, 0, 0, 0, 0, 0},
+        /* 0x6B */ {NO_RULE},
+        /* 0x6F JAL */ {classifyJal64, classifyJal64, classifyJal64, classifyJal64, classifyJal64, classifyJal64, classifyJal64, classifyJal64},
+        /* 0x73 */ {NO_RULE},
+        /* 0x77 */ {NO_RULE},
+        /* 0x7B */ {NO_RULE},
+        /* 0x7F */ {NO_RULE}};
+
+static Ctype classify(const Instruction *source, unsigned int isa) {
+	/* 1. Only 32-bit instructions (lowest bits 11) are in the table */
+	ClassifyFunction *rule;
+	Ctype type;
+	if ((source->opcode & 0x3) != 0x3) return NON;
+	/* 2. Floating-point loads and stores only with their extension, funct3 2 is F and 3 is D, Zcmp takes the encodings of D */
+	if (isa & ISA_ZCMP) isa &= ~(unsigned int) ISA_D;
+	if ((source->opcode == 0x07 || source->opcode == 0x27) && !(isa & (source->funct3 == 0x2 ? ISA_F : ISA_D))) return NON;
+	/* 3. A single lookup finds the only check that applies */
+	rule = (isa & ISA_RV64 ? classifiers64 : classifiers)[(source->opcode >> 2) & 0x1F][source->funct3 & 0x7];
+	type = rule == NULL ? NON : rule(source);
+	/* 4. Zcb forms only with Zcb, none of them has another compressed form to fall back to */
+	return type >= LBU && type <= MUL && !(isa & ISA_ZCB) ? NON : type;
+}
+
+/* How the immediate of the compressed instruction comes from the original one */
+typedef enum ImmKind { IMM_NONE = 0, IMM_SIGNED, IMM_WORD, IMM_UPPER, IMM_OFFSET } ImmKind;
+
+/* Where a register field of the compressed instruction comes from, *_PRIME ones are x8 ~ x15 */
+typedef enum Operand { FROM_NONE = 0, FROM_RD, FROM_RD_PRIME, FROM_RS1, FROM_RS1_PRIME, FROM_RS2, FROM_RS2_PRIME } Operand;
+
+typedef struct Encoding {
+	CFormat format;
+	short opcode, funct4, funct3, funct6, funct2;
+	ImmKind imm;
+	/* Sources of the rd, rs1 and rs2 fields of Compressed */
+	Operand rd, rs1, rs2;
+} Encoding;
+
+/* Encoding table, indexed by Ctype, unused fields are 0 */
+static const Encoding encodings[] = {
+        /* NON  */ {CR, 0, 0, 0, 0, 0, IMM_NONE, FROM_NONE, FROM_NONE, FROM_NONE},
+        /* ADD  */ {CR, 2, 9, 0, 0, 0, IMM_NONE, FROM_RD, FROM_NONE, FROM_RS2},
+        /* MV   */ {CR, 2, 8, 0, 0, 0, IMM_NONE, FROM_RD, FROM_NONE, FROM_RS2},
+        /* JR   */ {CR, 2, 8, 0, 0, 0, IMM_NONE, FROM_RS1, FROM_RS1, FROM_NONE},
+        /* JALR */ {CR, 2, 9, 0, 0, 0, IMM_NONE, FROM_RS1, FROM_RS1, FROM_NONE},
+        /* LI   */ {CI, 1, 0, 2, 0, 0, IMM_SIGNED, FROM_RD, FROM_NONE, FROM_NONE},
+        /* LUI  */ {CI, 1, 0, 3, 0, 0, IMM_UPPER, FROM_RD, FROM_NONE, FROM_NONE},
+        /* ADDI */ {CI, 1, 0, 0, 0, 0, IMM_SIGNED, FROM_RD, FROM_NONE, FROM_NONE},
+        /* SLLI */ {CI, 2, 0, 0, 0, 0, IMM_SIGNED, FROM_RD, FROM_NONE, FROM_NONE},
+        /* LW   */ {CL, 0, 0, 2, 0, 0, IMM_WORD, FROM_RD_PRIME, FROM_RS1_PRIME, FROM_NONE},
+        /* SW   */ {CS, 0, 0, 6, 0, 0, IMM_WORD, FROM_NONE, FROM_RS1_PRIME, FROM_RS2_PRIME},
+        /* AND  */ {CA, 1, 0, 0, 35, 3, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_RS2_PRIME},
+        /* OR   */ {CA, 1, 0, 0, 35, 2, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_RS2_PRIME},
+        /* XOR  */ {CA, 1, 0, 0, 35, 1, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_RS2_PRIME},
+        /* SUB  */ {CA, 1, 0, 0, 35, 0, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_RS2_PRIME},
+        /* BEQZ */ {CB, 1, 0, 6, 0, 0, IMM_OFFSET, FROM_NONE, FROM_RS1_PRIME, FROM_NONE},
+        /* BNEZ */ {CB, 1, 0, 7, 0, 0, IMM_OFFSET, FROM_NONE, FROM_RS1_PRIME, FROM_NONE},
+        /* SRLI */ {CBI, 1, 0, 4, 0, 0, IMM_SIGNED, FROM_RD_PRIME, FROM_NONE, FROM_NONE},
+        /* SRAI */ {CBI, 1, 0, 4, 0, 1, IMM_SIGNED, FROM_RD_PRIME, FROM_NONE, FROM_NONE},
+        /* ANDI */ {CBI, 1, 0, 4, 0, 2, IMM_SIGNED, FROM_RD_PRIME, FROM_NONE, FROM_NONE},
+        /* J    */ {CJ, 1, 0, 5, 0, 0, IMM_OFFSET, FROM_NONE, FROM_NONE, FROM_NONE},
+        /* JAL  */ {CJ, 1, 0, 1, 0, 0, IMM_OFFSET, FROM_NONE, FROM_NONE, FROM_NONE},
+        /* LWSP */ {CIL, 2, 0, 2, 0, 0, IMM_SIGNED, FROM_RD, FROM_NONE, FROM_NONE},
+        /* SWSP */ {CSS, 2, 0, 6, 0, 0, IMM_SIGNED, FROM_NONE, FROM_NONE, FROM_RS2},
+        /* ADDI16SP */ {CIS, 1, 0, 3, 0, 0, IMM_SIGNED, FROM_RD, FROM_NONE, FROM_NONE},
+        /* ADDI4SPN */ {CIW, 0, 0, 0, 0, 0, IMM_SIGNED, FROM_RD_PRIME, FROM_NONE, FROM_NONE},
+        /* LD   */ {CLD, 0, 0, 3, 0, 0, IMM_SIGNED, FROM_RD_PRIME, FROM_RS1_PRIME, FROM_NONE},
+        /* SD   */ {CSD, 0, 0, 7, 0, 0, IMM_SIGNED, FROM_NONE, FROM_RS1_PRIME, FROM_RS2_PRIME},
+        /* LDSP */ {CILD, 2, 0, 3, 0, 0, IMM_SIGNED, FROM_RD, FROM_NONE, FROM_NONE},
+        /* SDSP */ {CSSD, 2, 0, 7, 0, 0, IMM_SIGNED, FROM_NONE, FROM_NONE, FROM_RS2},
+        /* ADDIW */ {CI, 1, 0, 1, 0, 0, IMM_SIGNED, FROM_RD, FROM_NONE, FROM_NONE},
+        /* ADDW */ {CA, 1, 0, 0, 39, 1, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_RS2_PRIME},
+        /* SUBW */ {CA, 1, 0, 0, 39, 0, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_RS2_PRIME},
+        /* FLW  */ {CL, 0, 0, 3, 0, 0, IMM_WORD, FROM_RD_PRIME, FROM_RS1_PRIME, FROM_NONE},
+        /* FSW  */ {CS, 0, 0, 7, 0, 0, IMM_WORD, FROM_NONE, FROM_RS1_PRIME, FROM_RS2_PRIME},
+        /* FLWSP */ {CIL, 2, 0, 3, 0, 0, IMM_SIGNED, FROM_RD, FROM_NONE, FROM_NONE},
+        /* FSWSP */ {CSS, 2, 0, 7, 0, 0, IMM_SIGNED, FROM_NONE, FROM_NONE, FROM_RS2},
+        /* FLD  */ {CLD, 0, 0, 1, 0, 0, IMM_SIGNED, FROM_RD_PRIME, FROM_RS1_PRIME, FROM_NONE},
+        /* FSD  */ {CSD, 0, 0, 5, 0, 0, IMM_SIGNED, FROM_NONE, FROM_RS1_PRIME, FROM_RS2_PRIME},
+        /* FLDSP */ {CILD, 2, 0, 1, 0, 0, IMM_SIGNED, FROM_RD, FROM_NONE, FROM_NONE},
+        /* FSDSP */ {CSSD, 2, 0, 5, 0, 0, IMM_SIGNED, FROM_NONE, FROM_NONE, FROM_RS2},
+        /* LBU  */ {CLB, 0, 0, 0, 32, 0, IMM_SIGNED, FROM_RD_PRIME, FROM_RS1_PRIME, FROM_NONE},
+        /* LHU  */ {CLH, 0, 0, 0, 33, 0, IMM_SIGNED, FROM_RD_PRIME, FROM_RS1_PRIME, FROM_NONE},
+        /* LH   */ {CLH, 0, 0, 0, 33, 1, IMM_SIGNED, FROM_RD_PRIME, FROM_RS1_PRIME, FROM_NONE},
+        /* SBYTE */ {CSB, 0, 0, 0, 34, 0, IMM_SIGNED, FROM_NONE, FROM_RS1_PRIME, FROM_RS2_PRIME},
+        /* SHALF */ {CSH, 0, 0, 0, 35, 0, IMM_SIGNED, FROM_NONE, FROM_RS1_PRIME, FROM_RS2_PRIME},
+        /* ZEXTB */ {CU, 1, 0, 0, 39, 3, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_NONE},
+        /* SEXTB */ {CU, 1, 0, 1, 39, 3, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_NONE},
+        /* ZEXTH */ {CU, 1, 0, 2, 39, 3, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_NONE},
+        /* SEXTH */ {CU, 1, 0, 3, 39, 3, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_NONE},
+        /* ZEXTW */ {CU, 1, 0, 4, 39, 3, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_NONE},
+        /* NOT  */ {CU, 1, 0, 5, 39, 3, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_NONE},
+        /* MUL  */ {CA, 1, 0, 0, 39, 2, IMM_NONE, FROM_RD_PRIME, FROM_NONE, FROM_RS2_PRIME},
+        /* PUSH */ {CMPP, 2, 0, 0, 46, 0, IMM_NONE, FROM_NONE, FROM_NONE, FROM_NONE},
+        /* POP  */ {CMPP, 2, 0, 0, 46, 2, IMM_NONE, FROM_NONE, FROM_NONE, FROM_NONE},
+        /* POPRET */ {CMPP, 2, 0, 0, 47, 2, IMM_NONE, FROM_NONE, FROM_NONE, FROM_NONE},
+        /* MVSA01 */ {CMMV, 2, 0, 0, 43, 1, IMM_NONE, FROM_NONE, FROM_NONE, FROM_NONE},
+        /* FOLDED */ {CR, 0, 0, 0, 0, 0, IMM_NONE, FROM_NONE, FROM_NONE, FROM_NONE}};
+
+static short operand(const Instruction *source, Operand from) {
+	/* Pick the register field named by the encoding table */
+	switch (from) {
+		case FROM_RD:
+			return source->rd;
+		case FROM_RD_PRIME:
+			return compressRegister(source->rd);
+		case FROM_RS1:
+			return source->rs1;
+		case FROM_RS1_PRIME:
+			return compressRegister(source->rs1);
+		case FROM_RS2:
+			return source->rs2;
+		case FROM_RS2_PRIME:
+			return compressRegister(source->rs2);
 		default:
-			/* NON, such case should not exist! */
-			printf("Cannot assert opcode!");
-			return -1;
+			return 0;
 	}
 }
 
-/* Return -1 by default */
-static short assertFunct4(const Instruction *source) {
-	/* Only CR-format compressed instruction has Funct4 code */
-	switch (assertCType(source)) {
-		case ADD:  /* 1001 */
-		case JALR: /* 1001 */
-			return 9;
-		case MV: /* 1000 */
-		case JR: /* 1000 */
-			return 8;
-		default: /* Other type of compressed instruction */
-			return -1;
+static int immediate(const Instruction *source, ImmKind kind) {
+	/* Turn the immediate of the original instruction into the one the compressed format encodes */
+	switch (kind) {
+		case IMM_SIGNED:
+			return (int) signExtend(source->imm, 12);
+		case IMM_WORD:
+			return (int) (signExtend(source->imm, 12) >> 2);
+		case IMM_UPPER:
+			return (int) signExtend(source->imm >> 12, 20);
+		case IMM_OFFSET:
+			return (int) branchOffset(source);
+		default:
+			return 0;
 	}
 }
 
-/* Return -1 by default */
-static short assertFunct3(const Instruction *source) {
-	switch (assertCType(source)) {
-		case LI: /* 010 */
-		case LW: /* 010 */
-			return 2;
-		case LUI: /* 011 */
-			return 3;
-		case ADDI: /* 000 */
-		case SLLI: /* 000 */
-			return 0;
-		case SW:   /* 110 */
-		case BEQZ: /* 110 */
-			return 6;
-		case BNEZ: /* 111 */
-			return 7;
-		case SRLI: /* 100 */
-		case SRAI: /* 100 */
-		case ANDI: /* 100 */
-			return 4;
-		case JAL: /* 001 */
-			return 1;
-		case J: /* 101 */
-			return 5;
-		default: /* Some instructions don't have a Funct3 code */
-			return -1;
+static void compressInstruction(const Instruction *source, Ctype type, Compressed *target) {
+	/* 1. Every field comes from the row of the encoding table */
+	const Encoding *encoding = &encodings[type];
+	target->type = type;
+	target->format = encoding->format;
+	target->opcode = encoding->opcode;
+	target->funct4 = encoding->funct4;
+	target->funct3 = encoding->funct3;
+	target->funct6 = encoding->funct6;
+	target->funct2 = encoding->funct2;
+	target->imm = immediate(source, encoding->imm);
+	target->rd = operand(source, encoding->rd);
+	target->rs1 = operand(source, encoding->rs1);
+	target->rs2 = operand(source, encoding->rs2);
+}
+
+static uint16_t encodeAs(const Instruction *source, Ctype type) {
+	/* The compressed instruction only lives on the stack until it is encoded */
+	Compressed compressed;
+	compressInstruction(source, type, &compressed);
+	return (uint16_t) generate16bit(&compressed);
+}
+
+static size_t compressRange(Program *program, size_t begin, size_t end) {
+	size_t i, invalid = end; /* Auxiliary vars */
+	/* 1. Loop through the instructions of this range, NON stays for those that cannot be compressed */
+	for (i = begin; i < end; ++i) {
+		Instruction source;
+		if (parse(program->words[i], &source)) {
+			/* 2. Unknown instructions stay as they are, the first one is reported */
+			if (invalid == end) invalid = i;
+			program->types[i] = NON;
+			continue;
+		}
+		/* 3. Classify once, and encode right away, pinned instructions keep their 32 bits */
+		program->types[i] = program->pinned != NULL && program->pinned[i] ? NON : (uint8_t) classify(&source, program->isa);
+		if (program->types[i] != NON) program->encoded[i] = encodeAs(&source, (Ctype) program->types[i]);
 	}
+	return invalid;
+}
+
+static int addressNeedsUpdate(uint32_t word) {
+	/* Branches (SB) and jal (UJ) */
+	return (word & 0x7F) == 0x63 || (word & 0x7F) == 0x6F;
+}
+
+static short listRegister(size_t index) {
+	/* Registers of a Zcmp list in the order they are saved: ra, s0, s1, then s2 ~ s11 (x18 ~ x27) */
+	return (short) (index == 0 ? 1 : index < 3 ? 7 + index : 15 + index);
+}
+
+static short sPrime(short reg) {
+	/* s0, s1 and s2 ~ s7 are the 3-bit registers of cm.mvsa01 */
+	if (reg == 8 || reg == 9) return (short) (reg - 8);
+	if (reg >= 18 && reg <= 23) return (short) (reg - 16);
+	return -1;
 }
 
-/* Return -1 by default */
-static short assertFunct6(const Instruction *source) {
-	switch (assertCType(source)) {
-		case AND: /* 100011 */
-		case OR:  /* 100011 */
-		case XOR: /* 100011 */
-		case SUB: /* 100011 */
-			return 35;
-		default: /* Some instructions don't have a Funct6 code */
-			return -1;
+static int stackAdjust(uint32_t word, long *adjust) {
+	/* addi sp, sp, adjust */
+	if ((word & 0xFFFFF) != 0x10113) return 0;
+	*adjust = signExtend(word >> 20, 12);
+	return 1;
+}
+
+static int stackSlot(uint32_t word, short opcode, short funct3, short reg, long *offset) {
+	Instruction source;
+	/* A load of reg from sp + offset (opcode 0x03) or a store of reg to it (0x23), with the width of funct3 */
+	if (parse(word, &source) || source.opcode != opcode || source.funct3 != funct3 || source.rs1 != 0x2) return 0;
+	if ((opcode == 0x03 ? source.rd : source.rs2) != reg) return 0;
+	*offset = signExtend(source.imm, 12);
+	return 1;
+}
+
+static int listSlots(const uint32_t *words, size_t n, short opcode, short funct3, long adjust, long width) {
+	long offset, base = ((long) n * width + 15) / 16 * 16;
+	size_t i;
+	/* 1. ra and s0 ~ s9, or all of s0 ~ s11, the spare room above the list is 0 ~ 48 bytes */
+	if (n == 0 || n == 12 || n > 13 || adjust < base || adjust > base + 48 || (adjust - base) % 16 != 0) return -1;
+	/* 2. The last register of the list right below the old sp, ra the lowest */
+	for (i = 0; i < n; ++i) {
+		if (!stackSlot(words[i], opcode, funct3, listRegister(i), &offset) || offset != adjust - width * (long) (n - i)) return -1;
 	}
+	return (int) ((adjust - base) / 16);
 }
 
-/* Return -1 by default */
-static short assertFunct2(const Instruction *source) {
-	switch (assertCType(source)) {
-		case AND: /* 11 */
-			return 3;
-		case OR:   /* 10 */
-		case ANDI: /* 10 */
-			return 2;
-		case XOR:  /* 01 */
-		case SRAI: /* 01 */
-			return 1;
-		case SUB:  /* 00 */
-		case SRLI: /* 00 */
-			return 0;
-		default: /* Some instructions don't have a Funct6 code */
-			return -1;
+static size_t matchSequence(const uint32_t *words, size_t count, unsigned int isa, Compressed *target) {
+	Instruction first, second;
+	short funct3 = isa & ISA_RV64 ? 0x3 : 0x2;
+	long width = isa & ISA_RV64 ? 8 : 4, adjust, offset;
+	size_t n;
+	int spare = -1;
+	if (!(isa & ISA_ZCMP) || count == 0 || parse(words[0], &first)) return 0;
+	/* 1. cm.push, the stack grows first, then the list is saved from ra on, as many registers as fit the layout */
+	if (stackAdjust(words[0], &adjust) && adjust < 0) {
+		for (n = 0; n < 13 && n + 1 < count && stackSlot(words[n + 1], 0x23, funct3, listRegister(n), &offset); ++n) continue;
+		for (; n > 0 && (spare = listSlots(words + 1, n, 0x23, funct3, -adjust, width)) < 0; --n) continue;
+		if (spare < 0) return 0;
+		compressInstruction(&first, PUSH, target);
+		target->rd = (short) (n == 13 ? 15 : n + 3);
+		target->imm = spare;
+		return n + 1;
+	}
+	/* 2. cm.pop, the list is restored from ra on, then the stack shrinks, cm.popret returns (jalr x0, 0(ra)) at last */
+	for (n = 0; n < 13 && n < count && stackSlot(words[n], 0x03, funct3, listRegister(n), &offset); ++n) continue;
+	if (n > 0) {
+		if (n == count || !stackAdjust(words[n], &adjust) || (spare = listSlots(words, n, 0x03, funct3, adjust, width)) < 0) return 0;
+		compressInstruction(&first, n + 1 < count && words[n + 1] == 0x8067 ? POPRET : POP, target);
+		target->rd = (short) (n == 13 ? 15 : n + 3);
+		target->imm = spare;
+		return target->type == POPRET ? n + 2 : n + 1;
 	}
+	/* 3. cm.mvsa01, a0 and a1 moved (addi rd, rs, 0) into two different s registers */
+	if (count < 2 || parse(words[1], &second) || (words[0] & 0xFFFFF07F) != 0x50013 || (words[1] & 0xFFFFF07F) != 0x58013) return 0;
+	if (sPrime(first.rd) < 0 || sPrime(second.rd) < 0 || first.rd == second.rd) return 0;
+	compressInstruction(&first, MVSA01, target);
+	target->rs1 = sPrime(first.rd);
+	target->rs2 = sPrime(second.rd);
+	return 2;
 }
 
-/* Return INT_MIN by default */
-static int assertImm(const Instruction *source) {
-	switch (assertCType(source)) {
-		case LI: /* This case has sign-extended number */
-		case ADDI: /* This case has sign-extended number */
-		case SLLI: /* This case has sign-extended number */
-		case SRLI: /* This case has sign-extended number */
-		case SRAI: /* This case has sign-extended number */
-		case ANDI: /* This case has sign-extended number */
-			return parseNumber(source->imm);
-		case LW:
-		case SW:
-			return parseNumber(source->imm >> 2);
-		case LUI: /* This case has sign-extended number */
-			return parseNumber(source->imm >> 12);
-		case BEQZ: /* This case has sign-extended number */
-		case BNEZ: /* This case has sign-extended number */
-		case J: /* This case has sign-extended number */
-		case JAL: /* This case has sign-extended number */
-			return parseNumber(source->imm >> 1) * 2;
-		default: /* Return INT_MIN on default */
-			return INT_MIN;
+static int foldSequences(Program *program) {
+	size_t i, j, length;
+	/* 1. Instructions some branch or jump lands on, a run may start there but not go on past it */
+	uint8_t *targets = calloc(program->count + 1, 1);
+	if (targets == NULL) return 1;
+	for (i = 0; i < program->count; ++i) {
+		Instruction source;
+		long target;
+		if (!addressNeedsUpdate(program->words[i])) continue;
+		parse(program->words[i], &source);
+		target = 4 * (long) i + branchOffset(&source);
+		if (target >= 0 && target / 4 < (long) program->count) targets[target / 4] = 1;
 	}
+	/* 2. Every run becomes its first instruction, the others are folded into it and take no room */
+	for (i = 0; i < program->count; i += length == 0 ? 1 : length) {
+		Compressed compressed;
+		length = matchSequence(program->words + i, program->count - i, program->isa, &compressed);
+		for (j = 0; j < length; ++j) {
+			if ((j != 0 && targets[i + j]) || (program->pinned != NULL && program->pinned[i + j])) length = 0;
+		}
+		if (length == 0) continue;
+		program->types[i] = (uint8_t) compressed.type;
+		program->encoded[i] = (uint16_t) generate16bit(&compressed);
+		for (j = 1; j < length; ++j) program->types[i + j] = FOLDED;
+	}
+	free(targets);
+	return 0;
 }
 
-/* Return -1 by default */
-static short assertRd(const Instruction *source) {
-	switch (assertCType(source)) {
-		case ADD: /* Return the original value */
-		case MV: /* Return the original value */
-		case JR: /* Return the original value */
-		case JALR: /* Return the original value */
-		case LI: /* Return the original value */
-		case LUI: /* Return the original value */
-		case ADDI: /* Return the original value */
-		case SLLI: /* Return the original value */
-			return source->rd;
-		case LW: /* Return the compressed value */
-		case AND: /* Return the compressed value */
-		case OR: /* Return the compressed value */
-		case XOR: /* Return the compressed value */
-		case SUB: /* Return the compressed value */
-		case SRLI: /* Return the compressed value */
-		case SRAI: /* Return the compressed value */
-		case ANDI: /* Return the compressed value */
-			return compressRegister(source->rd);
-		default: /* Return -1 by default */
-			return -1;
+/* Shared state of primaryCompression() */
+typedef struct CompressPass {
+	Program *program;
+	/* First unknown instruction of each range, the end of the range if there is none */
+	size_t invalid[MAX_THREADS];
+	size_t end[MAX_THREADS];
+} CompressPass;
+
+static void compressWorker(void *context, size_t begin, size_t end, int worker) {
+	CompressPass *pass = context;
+	pass->invalid[worker] = compressRange(pass->program, begin, end);
+	pass->end[worker] = end;
+}
+
+int primaryCompression(Program *program) {
+	CompressPass pass;
+	int i;
+	/* 1. Check validation */
+	if (program == NULL) return 1;
+	/* 2. Every instruction is compressed on its own, so the stream is simply split between the threads */
+	pass.program = program;
+	for (i = 0; i < MAX_THREADS; ++i) pass.invalid[i] = pass.end[i] = 0;
+	parallelFor(program->threads, program->count, compressWorker, &pass);
+	/* 3. The first range with an unknown instruction has the first one */
+	program->invalid = program->count;
+	for (i = 0; i < MAX_THREADS; ++i) {
+		if (pass.invalid[i] != pass.end[i]) {
+			program->invalid = pass.invalid[i];
+			return 2;
+		}
 	}
+	/* 4. Zcmp runs replace what the instructions became on their own, one pass since runs cross any split */
+	if (program->isa & ISA_ZCMP) return foldSequences(program);
+	return 0;
 }
 
-/* Return -1 by default */
-static short assertRs1(const Instruction *source) {
-	switch (assertCType(source)) {
-		case LW: /* Return the compressed value */
-		case SW: /* Return the compressed value */
-		case BNEZ: /* Return the compressed value */
-		case BEQZ: /* Return the compressed value */
-			return compressRegister(source->rs1);
-		case JR: /* Return the original value */
-		case JALR: /* Return the original value */
-			return source->rs1;
-		default: /* Return -1 by default */
-			return -1;
+static uint32_t updateSBType(uint32_t word, unsigned long imm) {
+	/* 1. Clean the imm field, 2. Add the new imm */
+	return (uint32_t) ((word & ~0xFE000F80UL) | IMM_SCATTER_SB(imm));
+}
+
+static uint32_t updateUJType(uint32_t word, unsigned long imm) {
+	/* 1. Clean the imm field, 2. Add the new imm */
+	return (uint32_t) ((word & ~0xFFFFF000UL) | IMM_SCATTER_UJ(imm));
+}
+
+long mapOffset(const uint32_t *map, size_t count, long offset) {
+	long index;
+	/* 1. Code before the start keeps 4 bytes per instruction */
+	if (offset < 0) return offset;
+	/* 2. So does code past the end */
+	index = offset / 4;
+	if ((size_t) index >= count) return (long) map[count] + (offset - 4 * (long) count);
+	/* 3. Offsets inside an instruction keep their distance from its start */
+	return (long) map[index] + offset % 4;
+}
+
+static long relocatedOffset(const uint32_t *map, size_t count, size_t i, const Instruction *source) {
+	/* The distance between the new addresses of the target and of the branch */
+	return mapOffset(map, count, 4 * (long) i + branchOffset(source)) - (long) map[i];
+}
+
+static void fillAddresses(const Program *program, uint32_t *map, size_t begin, size_t end) {
+	size_t i;
+	/* Continue the prefix sum of the new sizes from map[begin] */
+	for (i = begin; i < end; ++i) map[i + 1] = map[i] + COMPRESSED_SIZE(program->types[i]);
+}
+
+static void promoteBranches(Program *program, size_t begin, size_t end) {
+	size_t i;
+	for (i = begin; i < end; ++i) {
+		Instruction candidate;
+		if (!addressNeedsUpdate(program->words[i]) || (program->pinned != NULL && program->pinned[i])) continue;
+		/* Every branch whose registers allow it starts compressed, as if its target were right next to it */
+		parse(program->words[i], &candidate);
+		candidate.imm = 0;
+		program->types[i] = (uint8_t) classify(&candidate, program->isa);
 	}
 }
 
-/* Return -1 by default */
-static short assertRs2(const Instruction *source) {
-	switch (assertCType(source)) {
-		case ADD: /* Return the original value */
-		case MV: /* Return the original value */
-			return source->rs2;
-		case LW: /* Return the compressed value */
-		case SW: /* Return the compressed value */
-		case AND: /* Return the compressed value */
-		case OR: /* Return the compressed value */
-		case XOR: /* Return the compressed value */
-		case SUB: /* Return the compressed value */
-			return compressRegister(source->rs2);
-		default: /* Return -1 by default */
-			return -1;
+static int demoteBranches(Program *program, const uint32_t *map, size_t begin, size_t end) {
+	size_t i;
+	int changed = 0;
+	for (i = begin; i < end; ++i) {
+		Instruction candidate;
+		if (program->types[i] == NON || !addressNeedsUpdate(program->words[i])) continue;
+		/* 1. Classify the branch again, with its offset according to the map */
+		parse(program->words[i], &candidate);
+		candidate.imm = (unsigned long) relocatedOffset(map, program->count, i, &candidate) & (candidate.type == SB ? 0x1FFF : 0x1FFFFF);
+		/* 2. A compressed branch that does not reach its target goes back to 32 bits */
+		if (classify(&candidate, program->isa) == NON) {
+			program->types[i] = NON;
+			changed = 1;
+		}
 	}
+	return changed;
 }
 
-Compressed **primaryCompression(const Instruction **source) {
-	Compressed **target;
-	int i; /* Auxiliary vars */
-	/* 1. Check validation */
-	if (source == NULL) { return NULL; }
-	/* 2. Allocate space for pointers */
-	target = malloc(sizeof(Compressed *) * 60);
-	for (i = 0; i < 60; ++i) { target[i] = NULL; }
-	{
-		/* 3. Loop through all instructions */
-		for (i = 0; i < 60; ++i) {
-			/* 4. The end of all instructions */
-			if (source[i] == NULL) break;
-			/* 5. Impossible to compress */
-			if (!source[i]->inCompressAbleList) continue;
-			/* 6. Can compress or not */
-			if (assertCType(source[i]) == NON) continue;
-			/* 7. Allocate space for compressed instruction */
-			target[i] = malloc(sizeof(Compressed));
-			/* 8. CType */
-			target[i]->type = assertCType(source[i]);
-			/* 9. opcode(compressed version) */
-			target[i]->opcode = assertOpcode(source[i]);
-			/* 10. Funct4 code */
-			target[i]->funct4 = assertFunct4(source[i]);
-			/* 11. Funct3 code */
-			target[i]->funct3 = assertFunct3(source[i]);
-			/* 12. Funct6 code */
-			target[i]->funct6 = assertFunct6(source[i]);
-			/* 13. Funct2 code */
-			target[i]->funct2 = assertFunct2(source[i]);
-			/* 14. imm field */
-			target[i]->imm = assertImm(source[i]);
-			/* 15. rd, aka rd/rs1 */
-			target[i]->rd = assertRd(source[i]);
-			/* 16. rs1 */
-			target[i]->rs1 = assertRs1(source[i]);
-			/* 17. rs2 */
-			target[i]->rs2 = assertRs2(source[i]);
+static void relocateBranches(Program *program, const uint32_t *map, size_t begin, size_t end) {
+	size_t i;
+	for (i = begin; i < end; ++i) {
+		Instruction source;
+		long new;
+		/* 1. Some instructions don't need to be updated */
+		if (!addressNeedsUpdate(program->words[i])) continue;
+		parse(program->words[i], &source);
+		new = relocatedOffset(map, program->count, i, &source);
+		/* 2. Set the new offsets */
+		source.imm = (unsigned long) new & (source.type == SB ? 0x1FFF : 0x1FFFFF);
+		if (program->types[i] != NON) {
+			program->encoded[i] = encodeAs(&source, (Ctype) program->types[i]);
+		} else if (source.type == SB) {
+			program->words[i] = updateSBType(program->words[i], source.imm); /* Call SB-Type instruction */
+		} else {
+			program->words[i] = updateUJType(program->words[i], source.imm); /* Call UJ-Type instruction */
 		}
 	}
-	/* 18. Return object */
-	return target;
-}
-
-static int addressNeedsUpdate(const Instruction *source) { return (source->type == SB || source->type == UJ); }
-
-static void updateSBType(Instruction *toUpdate) {
-	/* 1. Duplicate original imm */
-	unsigned long duplicate = toUpdate->originalValue;
-	/* 2. Clean the imm field */
-	duplicate &= ~0xFE000F80;
-	/* 3. Add the new imm */
-	duplicate |= ((toUpdate->imm & (1 << 12)) >> 12 << 31);
-	duplicate |= ((toUpdate->imm & 0x7E0) >> 5 << 25);
-	duplicate |= ((toUpdate->imm & 0x1E) >> 1 << 8);
-	duplicate |= ((toUpdate->imm & (1 << 11)) >> 11 << 7);
-	/* 4. Correct the new value */
-	toUpdate->originalValue = duplicate;
-}
-
-static void updateUJType(Instruction *toUpdate) {
-	/* 1. Duplicate original imm */
-	unsigned long duplicate = toUpdate->originalValue;
-	/* 2. Clean the imm field */
-	duplicate &= ~0xFFFFF000;
-	/* 3. Add the new imm */
-	duplicate |= ((toUpdate->imm & (1 << 20)) >> 20 << 31);
-	duplicate |= ((toUpdate->imm & 0x7FE) >> 1 << 21);
-	duplicate |= ((toUpdate->imm & (1 << 11)) >> 11 << 20);
-	duplicate |= ((toUpdate->imm & 0xFF000) >> 12 << 12);
-	/* 4. Correct the new value */
-	toUpdate->originalValue = duplicate;
-}
-
-static int parseNumber20(const unsigned long imm) {
-	/* 1. This function decides whether a 20-bit number can fit into bits */
-	unsigned long a = (imm >> 19) & 1;
-	if (a == 1) {
-		/* 2. Two's complement for negative numbers */
-		return (int) -(~(imm - 1) & 0xFFFFF);
+}
+
+/* Shared state of the parallel passes over the branches */
+typedef struct BranchPass {
+	Program *program;
+	/* Addresses according to the current choice of sizes */
+	const uint32_t *map;
+	/* Whether a range has changed anything, one slot per worker */
+	int changed[MAX_THREADS];
+} BranchPass;
+
+static void promoteRange(void *context, size_t begin, size_t end, int worker) {
+	BranchPass *pass = context;
+	(void) worker;
+	promoteBranches(pass->program, begin, end);
+}
+
+static void demoteRange(void *context, size_t begin, size_t end, int worker) {
+	BranchPass *pass = context;
+	pass->changed[worker] = demoteBranches(pass->program, pass->map, begin, end);
+}
+
+static void confirmRange(void *context, size_t begin, size_t end, int worker) {
+	BranchPass *pass = context;
+	(void) worker;
+	relocateBranches(pass->program, pass->map, begin, end);
+}
+
+int confirmAddress(Program *program) {
+	BranchPass pass;
+	/* 1. New address of every instruction, built once */
+	uint32_t *map = buildAddressMap(program);
+	if (map == NULL) return 1;
+	/* 2. Every branch only reads the map and writes its own slot */
+	pass.program = program;
+	pass.map = map;
+	parallelFor(program->threads, program->count, confirmRange, &pass);
+	free(map);
+	return 0;
+}
+
+/* Shared state of the parallel prefix sum */
+typedef struct PrefixSum {
+	const Program *program;
+	uint32_t *map;
+	/* New size of each range, then the new address where it starts */
+	uint32_t totals[MAX_THREADS];
+} PrefixSum;
+
+static void sumRange(void *context, size_t begin, size_t end, int worker) {
+	PrefixSum *sum = context;
+	uint32_t total = 0;
+	size_t i;
+	for (i = begin; i < end; ++i) total += COMPRESSED_SIZE(sum->program->types[i]);
+	sum->totals[worker] = total;
+}
+
+static void scanRange(void *context, size_t begin, size_t end, int worker) {
+	PrefixSum *sum = context;
+	/* Start from the address of the range, begin is 0 for the first one */
+	sum->map[begin] = sum->totals[worker];
+	fillAddresses(sum->program, sum->map, begin, end);
+}
+
+uint32_t *buildAddressMap(const Program *program) {
+	PrefixSum sum;
+	uint32_t start = 0;
+	int i, ranges = program->threads < 1 ? 1 : program->threads;
+	/* 1. One entry per instruction and one for the end of the code */
+	sum.program = program;
+	sum.map = malloc(sizeof(uint32_t) * (program->count + 1));
+	if (sum.map == NULL) return NULL;
+	sum.map[0] = 0;
+	if (ranges > MAX_THREADS) ranges = MAX_THREADS;
+	if ((size_t) ranges > program->count) ranges = program->count == 0 ? 1 : (int) program->count;
+	/* 2. Prefix sum of the new sizes, a single range needs only the second pass */
+	if (ranges > 1) {
+		/* 2.1 Size of every range */
+		parallelFor(ranges, program->count, sumRange, &sum);
+		/* 2.2 Addresses where the ranges start */
+		for (i = 0; i < ranges; ++i) {
+			uint32_t total = sum.totals[i];
+			sum.totals[i] = start;
+			start += total;
+		}
 	} else {
-		/* 3. Positive numbers */
-		return (int) imm;
+		sum.totals[0] = 0;
 	}
+	/* 2.3 Every range continues from its start */
+	parallelFor(ranges, program->count, scanRange, &sum);
+	return sum.map;
 }
 
-void confirmAddress(Instruction **origin, Compressed **compressed) {
-	/* 1. Original value */
-	int i;
-	for (i = 0; i < 60; ++i) {
-		int new = 0, imm = 0;
-		if (origin[i] == NULL) break;
-		/* 2. Some instructions don't need to be updated */
-		if (!addressNeedsUpdate(origin[i])) continue;
-		/* 3. Get the jump offset */
-		if (origin[i]->type == SB) {
-			imm = parseNumber(origin[i]->imm >> 1) * 2;
-		} else if (origin[i]->type == UJ) {
-			imm = parseNumber20(origin[i]->imm >> 1) * 2;
+int relaxBranches(Program *program) {
+	BranchPass pass;
+	int changed = 1, i;
+	/* 1. Start with every branch compressed that could be, sizes only grow from here on */
+	pass.program = program;
+	parallelFor(program->threads, program->count, promoteRange, &pass);
+	while (changed) {
+		/* 2. Addresses according to the current choice of sizes */
+		uint32_t *map = buildAddressMap(program);
+		if (map == NULL) return 1;
+		/* 3. The map is fixed during a pass, so the branches are independent of each other */
+		pass.map = map;
+		memset(pass.changed, 0, sizeof(pass.changed));
+		parallelFor(program->threads, program->count, demoteRange, &pass);
+		changed = 0;
+		for (i = 0; i < MAX_THREADS; ++i) changed |= pass.changed[i];
+		free(map);
+	}
+	/* 4. Nothing has changed during a whole pass: every compressed branch fits */
+	return 0;
+}
+
+void finalizeWindow(Program *program, uint32_t *map, size_t begin, size_t end) {
+	/* 1. Same as relaxBranches(), restricted to the window */
+	promoteBranches(program, begin, end);
+	do {
+		fillAddresses(program, map, begin, end);
+	} while (demoteBranches(program, map, begin, end));
+	/* 2. Same as confirmAddress() */
+	relocateBranches(program, map, begin, end);
+}
+
+size_t compressInstructions(Program *program, size_t begin, size_t end) { return compressRange(program, begin, end); }
+
+size_t compressSequence(const uint32_t *words, size_t count, unsigned int isa, unsigned int *parcel) {
+	Compressed compressed;
+	size_t length = matchSequence(words, count, isa, &compressed);
+	*parcel = length == 0 ? 0 : generate16bit(&compressed);
+	return length;
+}
+
+unsigned int compressWord(unsigned long word, unsigned int isa) {
+	Instruction source;
+	Ctype type;
+	if (parse(word, &source)) return 0;
+	type = classify(&source, isa);
+	return type == NON ? 0 : encodeAs(&source, type);
+}
+
+size_t windowCut(const Program *program, size_t begin, size_t end, size_t *reach) {
+	size_t i, cut = 0;
+	for (i = begin; i < end; ++i) {
+		if (addressNeedsUpdate(program->words[i])) {
+			Instruction source;
+			long offset;
+			/* 1. The new offset of a forward branch needs the sizes of everything before its target */
+			parse(program->words[i], &source);
+			offset = branchOffset(&source);
+			if (offset > 0 && i + (size_t) offset / 4 > *reach) *reach = i + (size_t) offset / 4;
 		}
-		/* 4. Calculate new offsets */
-		if (imm > 0) {
-			int j = i;
-			while (imm != 0) { /* When we need to count toward the end of file */
-				imm -= 4;
-				++j;
-				new += compressed[j - 1] == NULL ? 4 : 2; /* New address according to how many instructions are compressed */
-			}
-		} else if (imm < 0) { /* When we need to count toward the head of file */
-			int j = i;
-			while (imm != 0) {
-				imm += 4;
-				--j;
-				new -= compressed[j] == NULL ? 4 : 2; /* New address according to how many instructions are compressed */
-			}
+		/* 2. No forward branch so far jumps past the end of this instruction */
+		if (i + 1 >= *reach) cut = i + 1;
+	}
+	return cut;
+}
+
+/* Flags kept in the two lowest bits of each word during compactWords(), both are 1 in every known instruction */
+#define KEEP_FLAG 0x1    /* Cleared while the instruction is to become 16-bit */
+#define PENDING_FLAG 0x2 /* Cleared while a branch waits to go back to 32 bits at the end of a pass */
+
+/* Instructions per block of the index, one bit of IndexBlock.keep each */
+#define INDEX_BLOCK 32
+
+/* Address of the first instruction of a block, and which of its instructions stay 32-bit */
+typedef struct IndexBlock {
+	uint32_t start;
+	uint32_t keep;
+} IndexBlock;
+
+/* Addresses of a word buffer under compaction */
+typedef struct AddressIndex {
+	const uint32_t *code;
+	size_t count;
+	/* Full map of the caller if there is one, otherwise count / INDEX_BLOCK + 1 blocks */
+	uint32_t *map;
+	IndexBlock *blocks;
+} AddressIndex;
+
+static uint32_t countBits(uint32_t bits) {
+	/* Population count in a few steps, the same on every compiler */
+	bits = bits - ((bits >> 1) & 0x55555555UL);
+	bits = (bits & 0x33333333UL) + ((bits >> 2) & 0x33333333UL);
+	bits = (bits + (bits >> 4)) & 0x0F0F0F0FUL;
+	return (uint32_t) ((bits * 0x01010101UL) & 0xFFFFFFFFUL) >> 24;
+}
+
+static void indexAddresses(AddressIndex *index) {
+	size_t i;
+	uint32_t address = 0;
+	/* Prefix sum of the sizes, either complete or at the start of every block with a bit per 32-bit instruction */
+	for (i = 0; i < index->count; ++i) {
+		if (index->map != NULL) index->map[i] = address;
+		else if (i % INDEX_BLOCK == 0) {
+			index->blocks[i / INDEX_BLOCK].start = address;
+			index->blocks[i / INDEX_BLOCK].keep = 0;
 		}
-		/* 5. Set the new offsets */
-		if (origin[i]->type == SB) {
-			if (compressed[i] == NULL) {
-				origin[i]->imm = new & 0x1FFF;
-				updateSBType(origin[i]); /* Call SB-Type instruction */
-			} else {
-				compressed[i]->imm = new;
-			}
+		if (index->code[i] & KEEP_FLAG) {
+			if (index->map == NULL) index->blocks[i / INDEX_BLOCK].keep |= (uint32_t) 1 << (i % INDEX_BLOCK);
+			address += 4;
+		} else address += 2;
+	}
+	if (index->map != NULL) index->map[index->count] = address;
+	else if (index->count % INDEX_BLOCK == 0) {
+		index->blocks[index->count / INDEX_BLOCK].start = address;
+		index->blocks[index->count / INDEX_BLOCK].keep = 0;
+	}
+}
+
+static uint32_t addressOf(const AddressIndex *index, size_t k) {
+	const IndexBlock *block;
+	uint32_t before;
+	if (index->map != NULL) return index->map[k];
+	/* Start of the block, 2 bytes for each instruction before k in it and 2 more for each of those that stays 32-bit */
+	block = &index->blocks[k / INDEX_BLOCK];
+	before = (uint32_t) (k % INDEX_BLOCK);
+	return block->start + 2 * before + 2 * countBits(block->keep & (((uint32_t) 1 << before) - 1));
+}
 
-		} else if (origin[i]->type == UJ) { /* Actually should be "other cases" here */
-			if (compressed[i] == NULL) {
-				origin[i]->imm = new & 0x1FFFFF;
-				updateUJType(origin[i]); /* Call UJ-Type instruction */
-			} else {
-				compressed[i]->imm = new;
+static long indexedOffset(const AddressIndex *index, size_t i, long offset) {
+	/* Same as relocatedOffset(), through the index */
+	long target = 4 * (long) i + offset, new;
+	if (target < 0) new = target;
+	else if ((size_t) target / 4 >= index->count) new = (long) addressOf(index, index->count) + (target - 4 * (long) index->count);
+	else new = (long) addressOf(index, (size_t) target / 4) + target % 4;
+	return new - (long) addressOf(index, i);
+}
+
+static void writeParcel(unsigned char *bytes, unsigned long value, int length) {
+	/* Little-endian, whatever the host */
+	bytes[0] = (unsigned char) (value & 0xFF);
+	bytes[1] = (unsigned char) ((value >> 8) & 0xFF);
+	if (length == 32) {
+		bytes[2] = (unsigned char) ((value >> 16) & 0xFF);
+		bytes[3] = (unsigned char) ((value >> 24) & 0xFF);
+	}
+}
+
+int compactWords(uint32_t *code, size_t count, uint32_t *map, CompactResult *result) {
+	AddressIndex index;
+	unsigned char *bytes = (unsigned char *) code;
+	size_t i, position = 0;
+	int changed = 1;
+	/* 1. Check validation, nothing is touched unless every instruction is known */
+	result->length = result->compressed = result->branches = 0;
+	result->invalid = count;
+	for (i = 0; i < count; ++i) {
+		Instruction source;
+		if (parse(code[i], &source)) {
+			result->invalid = i;
+			return 2;
+		}
+		result->branches += addressNeedsUpdate(code[i]);
+	}
+	index.code = code;
+	index.count = count;
+	index.map = map;
+	index.blocks = NULL;
+	if (map == NULL && (index.blocks = malloc(sizeof(IndexBlock) * (count / INDEX_BLOCK + 1))) == NULL) return 1;
+	/* 2. Mark what becomes 16-bit, every branch that could be starts compressed as in relaxBranches() */
+	for (i = 0; i < count; ++i) {
+		Instruction source;
+		parse(code[i], &source);
+		if (addressNeedsUpdate(code[i])) source.imm = 0;
+		if (classify(&source, 0) != NON) code[i] &= ~(uint32_t) KEEP_FLAG;
+	}
+	/* 3. Branches that do not reach go back to 32 bits, at the end of each pass so that a pass sees fixed sizes */
+	while (changed) {
+		changed = 0;
+		indexAddresses(&index);
+		for (i = 0; i < count; ++i) {
+			Instruction candidate;
+			if (code[i] & KEEP_FLAG || !addressNeedsUpdate(code[i] | KEEP_FLAG)) continue;
+			parse(code[i] | KEEP_FLAG, &candidate);
+			candidate.imm = (unsigned long) indexedOffset(&index, i, branchOffset(&candidate)) & (candidate.type == SB ? 0x1FFF : 0x1FFFFF);
+			if (classify(&candidate, 0) == NON) {
+				code[i] &= ~(uint32_t) PENDING_FLAG;
+				changed = 1;
 			}
 		}
+		for (i = 0; i < count; ++i) {
+			if (!(code[i] & PENDING_FLAG)) code[i] |= KEEP_FLAG | PENDING_FLAG;
+		}
+	}
+	/* 4. Relocate every branch inside its own word, the new offset is never longer than the old one */
+	indexAddresses(&index);
+	for (i = 0; i < count; ++i) {
+		Instruction source;
+		uint32_t flag;
+		if (!addressNeedsUpdate(code[i] | KEEP_FLAG)) continue;
+		flag = code[i] & KEEP_FLAG;
+		parse(code[i] | KEEP_FLAG, &source);
+		source.imm = (unsigned long) indexedOffset(&index, i, branchOffset(&source)) & (source.type == SB ? 0x1FFF : 0x1FFFFF);
+		code[i] = (source.type == SB ? updateSBType(code[i] | KEEP_FLAG, source.imm) : updateUJType(code[i] | KEEP_FLAG, source.imm));
+		if (!flag) code[i] &= ~(uint32_t) KEEP_FLAG;
+	}
+	/* 5. Pack the instructions to the front, instruction i is read before anything is written past 4 * i */
+	for (i = 0; i < count; ++i) {
+		uint32_t word = code[i] | KEEP_FLAG;
+		if (map != NULL) map[i] = (uint32_t) position;
+		if (code[i] & KEEP_FLAG) {
+			writeParcel(bytes + position, word, 32);
+			position += 4;
+		} else {
+			Instruction source;
+			parse(word, &source);
+			writeParcel(bytes + position, encodeAs(&source, classify(&source, 0)), 16);
+			position += 2;
+			++result->compressed;
+		}
 	}
+	if (map != NULL) map[count] = (uint32_t) position;
+	result->length = position;
+	free(index.blocks);
+	return 0;
 }
@@ -3,10 +3,69 @@
 
 #include "utils.h"
 
-/* 1. Compress but not change address */
-Compressed **primaryCompression(const Instruction **source);
+/* What compactWords() has done */
+typedef struct CompactResult {
+	/* Size of the compacted code in bytes */
+	size_t length;
+	/* Number of instructions that became 16-bit, and of branches and jumps relocated */
+	size_t compressed;
+	size_t branches;
+	/* Index of the first instruction with an unknown opcode, count if there is none */
+	size_t invalid;
+} CompactResult;
 
-/* 2. Change addresses */
-void confirmAddress(Instruction **origin, Compressed **compressed);
+/* 1. Compress but not change address, sets types[] and encoded[] of every instruction. With ISA_ZCMP, every run of
+ *    compressSequence() that no branch or jump lands inside becomes its first instruction, the others are FOLDED.
+ *    Returns 1 when program is NULL or out of memory, 2 when some instruction has an unknown opcode (program->invalid
+ *    is the first one, it stays uncompressed) */
+int primaryCompression(Program *program);
+
+/* 2. Change addresses, every branch is resolved in O(1) through the map below. Returns 1 when out of memory */
+int confirmAddress(Program *program);
+
+/* 2.1 Compress as many branches and jumps as possible (call before confirmAddress). Every branch starts compressed,
+ *     those whose relocated offset does not fit go back to 32 bits until nothing changes. Sizes only grow, so the
+ *     result is the largest set of compressed branches that all fit, whatever the order of the work. Returns 1 when out of memory */
+int relaxBranches(Program *program);
+
+/* 3. New byte offset of every instruction, plus the total size at [count] */
+uint32_t *buildAddressMap(const Program *program);
+
+/* 4. New byte offset of an old byte offset, code outside the instructions keeps 4 bytes per instruction */
+long mapOffset(const uint32_t *map, size_t count, long offset);
+
+/* 5. Compress the instructions [begin, end) of the program, same as primaryCompression() on a part of it but one by one only.
+ *    Returns the first instruction with an unknown opcode, end if there is none */
+size_t compressInstructions(Program *program, size_t begin, size_t end);
+
+/* 6. relaxBranches() and confirmAddress() for the instructions [begin, end) of a growing program. map holds the
+ *    addresses of 0 ~ begin and has room for end + 1 entries, the rest is filled in. No branch of the window may
+ *    target past end unless end is the end of the complete program. The result is the same as for the whole
+ *    program at once: sizes before begin are final, and branches after end cannot change sizes inside */
+void finalizeWindow(Program *program, uint32_t *map, size_t begin, size_t end);
+
+/* 7. Scan the instructions [begin, end), reach tracks how many instructions the forward branches seen so far need.
+ *    Returns the last point in (begin, end] where a window may end (no forward branch jumps past it), 0 if there is none */
+size_t windowCut(const Program *program, size_t begin, size_t end, size_t *reach);
+
+/* 8. The whole translation inside the buffer of the caller, for RV32C: code holds count instructions and receives the compressed
+ *    code as little-endian bytes from its start, same as writeToBinary(). Sizes are kept in the two lowest bits of each word
+ *    meanwhile, and addresses in map (count + 1 entries, receives the new byte offset of every instruction) or, when map is
+ *    NULL, in an index of 8 bytes per 32 instructions that answers every lookup in constant time. Returns 1 when out of
+ *    memory, 2 when an instruction has an unknown opcode, code is left untouched in both cases */
+int compactWords(uint32_t *code, size_t count, uint32_t *map, CompactResult *result);
+
+/* 9. The 16-bit encoding of one instruction on its own for the instruction set isa (ISA_* flags), a branch or jump
+ *    with the offset it holds. Returns 0 (never a compressed instruction) when it stays 32-bit or has an unknown opcode */
+unsigned int compressWord(unsigned long word, unsigned int isa);
+
+/* Longest run compressSequence() replaces: cm.popret with ra, s0 ~ s11, the stack adjustment and the return */
+#define MAX_SEQUENCE 15
+
+/* 10. The Zcmp instruction (ISA_ZCMP) that replaces the run at the start of words (count of them) on its own, into parcel:
+ *     cm.push for addi sp, sp, -N and the saves of ra, s0 ~ sK in the layout of cm.push, cm.pop for the restores and
+ *     addi sp, sp, N, cm.popret for those and jalr x0, 0(ra), cm.mvsa01 for addi sA, a0, 0 and addi sB, a1, 0.
+ *     Returns the number of instructions replaced, 0 (and parcel 0) when there is no such run */
+size_t compressSequence(const uint32_t *words, size_t count, unsigned int isa, unsigned int *parcel);
 
 #endif
@@ -0,0 +1,443 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compression.h"
+#include "decompression.h"
+#include "imm.h"
+#include "parallel.h"
+
+/* One table per instruction set, built the first time it is asked for */
+static uint32_t *expansions[ISA_ALL + 1];
+static pthread_mutex_t expansionsLock = PTHREAD_MUTEX_INITIALIZER;
+
+static long signedField(unsigned long value, int bits) {
+	/* Two's complement value of the lowest (bits) bits */
+	long field = (long) (value & ((1UL << bits) - 1));
+	return (field >> (bits - 1)) & 1 ? field - (1L << bits) : field;
+}
+
+static uint32_t iWord(unsigned int opcode, unsigned int funct3, unsigned int rd, unsigned int rs1, long imm) {
+	return (uint32_t) (((unsigned long) imm & 0xFFF) << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode);
+}
+
+static uint32_t rWord(unsigned int opcode, unsigned int funct7, unsigned int funct3, unsigned int rd, unsigned int rs1, unsigned int rs2) {
+	return (uint32_t) ((unsigned long) funct7 << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode);
+}
+
+static uint32_t sWord(unsigned int opcode, unsigned int funct3, unsigned int rs1, unsigned int rs2, long imm) {
+	return (uint32_t) (((unsigned long) imm & 0xFE0) << 20 | rs2 << 20 | rs1 << 15 | funct3 << 12 | ((unsigned long) imm & 0x1F) << 7 | opcode);
+}
+
+static uint32_t branchWord(unsigned int funct3, unsigned int rs1, long offset) {
+	return (uint32_t) (IMM_SCATTER_SB((unsigned long) offset & 0x1FFF) | rs1 << 15 | funct3 << 12 | 0x63);
+}
+
+static uint32_t jumpWord(unsigned int rd, long offset) { return (uint32_t) (IMM_SCATTER_UJ((unsigned long) offset & 0x1FFFFF) | rd << 7 | 0x6F); }
+
+static uint32_t decodeParcel(unsigned int parcel, unsigned int isa) {
+	/* 1. Fields in the places generate16bit() puts them, x8 ~ x15 for the 3-bit ones */
+	unsigned int funct3 = parcel >> 13 & 0x7, rd = parcel >> 7 & 0x1F, rs2 = parcel >> 2 & 0x1F;
+	unsigned int rdPrime = (parcel >> 7 & 0x7) + 8, rs2Prime = (parcel >> 2 & 0x7) + 8;
+	unsigned int shamt = (parcel >> 12 & 1) << 5 | rs2;
+	long imm = signedField(shamt, 6);
+	if (isa & ISA_ZCMP) isa &= ~(unsigned int) ISA_D;
+	/* 2. RV64C puts its doubleword and W instructions in slots of RV32C */
+	if (isa & ISA_RV64) {
+		switch ((parcel & 0x3) << 3 | funct3) {
+			case 0x03: /* c.ld */
+				return iWord(0x03, 3, rs2Prime, rdPrime, (long) IMM_GATHER_CLD(parcel));
+			case 0x07: /* c.sd */
+				return sWord(0x23, 3, rdPrime, rs2Prime, (long) IMM_GATHER_CLD(parcel));
+			case 0x09: /* c.addiw */
+				return iWord(0x1B, 0, rd, rd, imm);
+			case 0x0C: /* c.subw and c.addw */
+				if ((parcel >> 10 & 0x7) == 0x7 && (parcel >> 5 & 0x3) < 2) return rWord(0x3B, parcel >> 5 & 1 ? 0 : 0x20, 0, rdPrime, rdPrime, rs2Prime);
+				break;
+			case 0x13: /* c.ldsp */
+				return iWord(0x03, 3, rd, 2, (long) IMM_GATHER_CILD(parcel));
+			case 0x17: /* c.sdsp */
+				return sWord(0x23, 3, 2, rs2, (long) IMM_GATHER_CSSD(parcel));
+			default:
+				break;
+		}
+	}
+	/* 3. The F and D extensions take the load and store slots RV32C leaves free, RV64C keeps c.ld and c.sd over c.flw and c.fsw */
+	switch ((parcel & 0x3) << 3 | funct3) {
+		case 0x01: /* c.fld */
+			if (isa & ISA_D) return iWord(0x07, 3, rs2Prime, rdPrime, (long) IMM_GATHER_CLD(parcel));
+			break;
+		case 0x03: /* c.flw */
+			if (isa & ISA_F) return iWord(0x07, 2, rs2Prime, rdPrime, (long) IMM_GATHER_CLS(parcel) << 2);
+			break;
+		case 0x05: /* c.fsd */
+			if (isa & ISA_D) return sWord(0x27, 3, rdPrime, rs2Prime, (long) IMM_GATHER_CLD(parcel));
+			break;
+		case 0x07: /* c.fsw */
+			if (isa & ISA_F) return sWord(0x27, 2, rdPrime, rs2Prime, (long) IMM_GATHER_CLS(parcel) << 2);
+			break;
+		case 0x11: /* c.fldsp */
+			if (isa & ISA_D) return iWord(0x07, 3, rd, 2, (long) IMM_GATHER_CILD(parcel));
+			break;
+		case 0x13: /* c.flwsp */
+			if (isa & ISA_F) return iWord(0x07, 2, rd, 2, (long) IMM_GATHER_CIL(parcel));
+			break;
+		case 0x15: /* c.fsdsp */
+			if (isa & ISA_D) return sWord(0x27, 3, 2, rs2, (long) IMM_GATHER_CSSD(parcel));
+			break;
+		case 0x17: /* c.fswsp */
+			if (isa & ISA_F) return sWord(0x27, 2, 2, rs2, (long) IMM_GATHER_CSS(parcel));
+			break;
+		default:
+			break;
+	}
+	/* 4. Zcb takes the reserved slot of quadrant 0 and the rest of the c.subw / c.addw one of quadrant 1 */
+	if (isa & ISA_ZCB) {
+		unsigned int bit6 = parcel >> 6 & 1, bit5 = parcel >> 5 & 1;
+		switch ((parcel & 0x3) << 3 | funct3) {
+			case 0x04:
+				switch (parcel >> 10 & 0x7) {
+					case 0: /* c.lbu */
+						return iWord(0x03, 4, rs2Prime, rdPrime, (long) (bit5 << 1 | bit6));
+					case 1: /* c.lhu, c.lh with bit 6 */
+						return iWord(0x03, bit6 ? 1 : 5, rs2Prime, rdPrime, (long) (bit5 << 1));
+					case 2: /* c.sb */
+						return sWord(0x23, 0, rdPrime, rs2Prime, (long) (bit5 << 1 | bit6));
+					default: /* c.sh */
+						return bit6 ? 0 : sWord(0x23, 1, rdPrime, rs2Prime, (long) (bit5 << 1));
+				}
+			case 0x0C:
+				if ((parcel >> 10 & 0x7) != 0x7 || !bit6) break;
+				/* c.mul */
+				if (!bit5) return rWord(0x33, 1, 0, rdPrime, rdPrime, rs2Prime);
+				switch (parcel >> 2 & 0x7) {
+					case 0: /* c.zext.b */
+						return iWord(0x13, 7, rdPrime, rdPrime, 0xFF);
+					case 1: /* c.sext.b */
+						return iWord(0x13, 1, rdPrime, rdPrime, 0x604);
+					case 2: /* c.zext.h */
+						return rWord(isa & ISA_RV64 ? 0x3B : 0x33, 0x4, 4, rdPrime, rdPrime, 0);
+					case 3: /* c.sext.h */
+						return iWord(0x13, 1, rdPrime, rdPrime, 0x605);
+					case 4: /* c.zext.w */
+						return rWord(0x3B, 0x4, 0, rdPrime, rdPrime, 0);
+					case 5: /* c.not */
+						return iWord(0x13, 4, rdPrime, rdPrime, -1);
+					default:
+						return 0;
+				}
+			default:
+				break;
+		}
+	}
+	/* 5. The quadrant and funct3 decide the instruction, the few shared slots are told apart inside */
+	switch ((parcel & 0x3) << 3 | funct3) {
+		case 0x00: /* c.addi4spn */
+			return iWord(0x13, 0, rs2Prime, 2, (long) IMM_GATHER_CIW(parcel));
+		case 0x02: /* c.lw */
+			return iWord(0x03, 2, rs2Prime, rdPrime, (long) IMM_GATHER_CLS(parcel) << 2);
+		case 0x06: /* c.sw */
+			return sWord(0x23, 2, rdPrime, rs2Prime, (long) IMM_GATHER_CLS(parcel) << 2);
+		case 0x08: /* c.addi */
+			return iWord(0x13, 0, rd, rd, imm);
+		case 0x09: /* c.jal */
+			return jumpWord(1, signedField(IMM_GATHER_CJ(parcel), 12));
+		case 0x0A: /* c.li */
+			return iWord(0x13, 0, rd, 0, imm);
+		case 0x0B: /* c.addi16sp with rd x2, c.lui otherwise */
+			if (rd == 2) return iWord(0x13, 0, 2, 2, signedField(IMM_GATHER_CIS(parcel), 10));
+			return (uint32_t) (((unsigned long) imm & 0xFFFFF) << 12 | rd << 7 | 0x37);
+		case 0x0C:
+			switch (parcel >> 10 & 0x3) {
+				case 0: /* c.srli */
+					return iWord(0x13, 5, rdPrime, rdPrime, (long) shamt);
+				case 1: /* c.srai */
+					return iWord(0x13, 5, rdPrime, rdPrime, (long) (0x400 | shamt));
+				case 2: /* c.andi */
+					return iWord(0x13, 7, rdPrime, rdPrime, imm);
+				default: { /* c.sub, c.xor, c.or and c.and */
+					static const unsigned int functs[4] = {0, 4, 6, 7};
+					unsigned int kind = parcel >> 5 & 0x3;
+					if (parcel >> 12 & 1) return 0;
+					return rWord(0x33, kind == 0 ? 0x20 : 0, functs[kind], rdPrime, rdPrime, rs2Prime);
+				}
+			}
+		case 0x0D: /* c.j */
+			return jumpWord(0, signedField(IMM_GATHER_CJ(parcel), 12));
+		case 0x0E: /* c.beqz */
+		case 0x0F: /* c.bnez */
+			return branchWord(funct3 - 6, rdPrime, signedField(IMM_GATHER_CB(parcel), 9));
+		case 0x10: /* c.slli */
+			return iWord(0x13, 1, rd, rd, (long) shamt);
+		case 0x12: /* c.lwsp */
+			return iWord(0x03, 2, rd, 2, (long) IMM_GATHER_CIL(parcel));
+		case 0x14:
+			/* c.jr / c.mv without bit 12, c.jalr / c.add with it */
+			if (rs2 == 0) return iWord(0x67, 0, parcel >> 12 & 1, rd, 0);
+			return rWord(0x33, 0, 0, rd, parcel >> 12 & 1 ? rd : 0, rs2);
+		case 0x16: /* c.swsp */
+			return sWord(0x23, 2, 2, rs2, (long) IMM_GATHER_CSS(parcel));
+		default:
+			return 0;
+	}
+}
+
+static unsigned int listRegister(size_t index) {
+	/* Registers of a Zcmp list in the order they are saved: ra, s0, s1, then s2 ~ s11 (x18 ~ x27) */
+	return (unsigned int) (index == 0 ? 1 : index < 3 ? 7 + index : 15 + index);
+}
+
+static size_t decodeSequence(unsigned int parcel, unsigned int isa, uint32_t *words) {
+	static const unsigned int sRegisters[8] = {8, 9, 18, 19, 20, 21, 22, 23};
+	unsigned int funct = parcel >> 8 & 0xFF, list = parcel >> 4 & 0xF, check;
+	unsigned int funct3 = isa & ISA_RV64 ? 3 : 2;
+	long width = isa & ISA_RV64 ? 8 : 4, adjust;
+	size_t length = 0, count, i;
+	if (!(isa & ISA_ZCMP) || (parcel & 0x3) != 0x2) return 0;
+	if ((parcel & 0xFC63) == 0xAC22) {
+		/* 1. cm.mvsa01 */
+		words[length++] = iWord(0x13, 0, sRegisters[parcel >> 7 & 0x7], 10, 0);
+		words[length++] = iWord(0x13, 0, sRegisters[parcel >> 2 & 0x7], 11, 0);
+	} else if ((funct == 0xB8 || funct == 0xBA || funct == 0xBE) && list >= 4) {
+		/* 2. cm.push saves the list after growing the stack, cm.pop and cm.popret restore it before shrinking it */
+		count = list == 15 ? 13 : list - 3;
+		adjust = ((long) count * width + 15) / 16 * 16 + 16 * (long) (parcel >> 2 & 0x3);
+		if (funct == 0xB8) words[length++] = iWord(0x13, 0, 2, 2, -adjust);
+		for (i = 0; i < count; ++i) {
+			long offset = adjust - width * (long) (count - i);
+			words[length++] = funct == 0xB8 ? sWord(0x23, funct3, 2, listRegister(i), offset) : iWord(0x03, funct3, listRegister(i), 2, offset);
+		}
+		if (funct != 0xB8) words[length++] = iWord(0x13, 0, 2, 2, adjust);
+		if (funct == 0xBE) words[length++] = iWord(0x67, 0, 0, 1, 0);
+	}
+	/* 3. Same as the table, only the runs the compressor produces count */
+	return length != 0 && compressSequence(words, length, isa, &check) == length && check == parcel ? length : 0;
+}
+
+static void buildExpansions(uint32_t *table, unsigned int isa) {
+	unsigned int parcel;
+	/* Decoding is loose, the round trip through the compressor keeps exactly the parcels it produces */
+	for (parcel = 0; parcel < PARCEL_COUNT; ++parcel) {
+		uint32_t word = (parcel & 0x3) == 0x3 ? 0 : decodeParcel(parcel, isa);
+		table[parcel] = word != 0 && compressWord(word, isa) == parcel ? word : 0;
+	}
+}
+
+const uint32_t *expansionTable(unsigned int isa) {
+	uint32_t *table;
+	isa &= ISA_ALL;
+	pthread_mutex_lock(&expansionsLock);
+	if (expansions[isa] == NULL && (expansions[isa] = malloc(sizeof(uint32_t) * PARCEL_COUNT)) != NULL) buildExpansions(expansions[isa], isa);
+	table = expansions[isa];
+	pthread_mutex_unlock(&expansionsLock);
+	return table;
+}
+
+Program *readFromParcels(const unsigned char *bytes, size_t length) {
+	size_t i = 0;
+	/* 1. At most one slot per parcel */
+	Program *target = newProgram(length / 2);
+	if (target == NULL) return NULL;
+	/* 2. The lowest bits of the first parcel tell 16-bit and 32-bit instructions apart */
+	while (i + 2 <= length) {
+		unsigned long word = (unsigned long) bytes[i] | ((unsigned long) bytes[i + 1] << 8);
+		if ((word & 0x3) == 0x3) {
+			if (i + 4 > length) break;
+			word |= ((unsigned long) bytes[i + 2] << 16) | ((unsigned long) bytes[i + 3] << 24);
+			i += 2;
+		}
+		i += 2;
+		if (appendWord(target, word)) {
+			clearAll(target);
+			return NULL;
+		}
+	}
+	return target;
+}
+
+Program *readParcelsFromBinary(FILE *in) {
+	MappedFile file;
+	Program *target;
+	/* The whole file is a flat stream of parcels */
+	if (mapFile(in, &file, 1)) return NULL;
+	target = readFromParcels(file.data, file.size);
+	unmapFile(&file);
+	return target;
+}
+
+uint32_t *parcelAddresses(const Program *program) {
+	size_t i;
+	/* One entry per instruction and one for the end of the code */
+	uint32_t *addresses = malloc(sizeof(uint32_t) * (program->count + 1));
+	if (addresses == NULL) return NULL;
+	addresses[0] = 0;
+	for (i = 0; i < program->count; ++i) addresses[i + 1] = addresses[i] + ((program->words[i] & 0x3) == 0x3 ? 4 : 2);
+	return addresses;
+}
+
+/* Shared state of expandParcels() and restoreBranches() */
+typedef struct ExpandPass {
+	Program *program;
+	const uint32_t *table;
+	const uint32_t *addresses;
+	/* Index of the instruction that holds every 2 bytes of the compressed code */
+	const uint32_t *owners;
+	/* Number of instructions in the compressed code, and the index each one starts at once Zcmp runs are unfolded (NULL if the same) */
+	size_t count;
+	const uint32_t *firsts;
+	/* Instructions each range adds by unfolding Zcmp runs */
+	size_t extra[MAX_THREADS];
+	/* First failing instruction of each range, the end of the range if there is none */
+	size_t failed[MAX_THREADS];
+	size_t end[MAX_THREADS];
+} ExpandPass;
+
+static void expandRange(void *context, size_t begin, size_t end, int worker) {
+	ExpandPass *pass = context;
+	Program *program = pass->program;
+	size_t i;
+	pass->failed[worker] = pass->end[worker] = end;
+	for (i = begin; i < end; ++i) {
+		uint32_t word = program->words[i], run[MAX_SEQUENCE];
+		size_t length;
+		program->types[i] = NON;
+		if ((word & 0x3) == 0x3) continue;
+		/* 1. A single load per parcel, 0 for those the compressor never produces */
+		if (pass->table[word & 0xFFFF] != 0) {
+			program->words[i] = pass->table[word & 0xFFFF];
+			continue;
+		}
+		/* 2. A Zcmp parcel stays until the program has grown room for its run */
+		length = decodeSequence(word & 0xFFFF, program->isa, run);
+		if (length != 0) pass->extra[worker] += length - 1;
+		else if (pass->failed[worker] == end) pass->failed[worker] = i;
+	}
+}
+
+static size_t firstFailure(const ExpandPass *pass, size_t count) {
+	int i;
+	for (i = 0; i < MAX_THREADS; ++i) {
+		if (pass->failed[i] != pass->end[i]) return pass->failed[i];
+	}
+	return count;
+}
+
+int expandParcels(Program *program) {
+	ExpandPass pass;
+	size_t extra = 0, next;
+	int i;
+	/* 1. Every parcel expands on its own, so the stream is simply split between the threads */
+	memset(&pass, 0, sizeof(pass));
+	pass.program = program;
+	pass.table = expansionTable(program->isa);
+	if (pass.table == NULL) return 1;
+	parallelFor(program->threads, program->count, expandRange, &pass);
+	/* 2. The first range with an unknown parcel has the first one */
+	program->invalid = firstFailure(&pass, program->count);
+	if (program->invalid != program->count) return 2;
+	for (i = 0; i < MAX_THREADS; ++i) extra += pass.extra[i];
+	if (extra == 0) return 0;
+	/* 3. Zcmp runs take a slot per instruction, filled from the end so that no parcel is overwritten before it is read */
+	if (reserveProgram(program, program->count + extra)) return 1;
+	for (i = program->count, next = program->count + extra; i > 0;) {
+		uint32_t word = program->words[--i], run[MAX_SEQUENCE];
+		size_t length = (word & 0x3) == 0x3 ? 0 : decodeSequence(word & 0xFFFF, program->isa, run);
+		if (length == 0) {
+			program->words[--next] = word;
+			program->types[next] = NON;
+			continue;
+		}
+		/* The instructions after the first are FOLDED until restoreBranches() has used them */
+		next -= length;
+		memcpy(program->words + next, run, sizeof(uint32_t) * length);
+		memset(program->types + next, FOLDED, length);
+		program->types[next] = NON;
+	}
+	program->count += extra;
+	program->invalid = program->count;
+	return 0;
+}
+
+static size_t expandedIndex(const ExpandPass *pass, size_t index) {
+	/* Where an instruction of the compressed code starts once Zcmp runs are unfolded */
+	return pass->firsts == NULL ? index : pass->firsts[index];
+}
+
+static long restoredTarget(const ExpandPass *pass, long target) {
+	size_t count = pass->count, owner;
+	/* 1. Code before the start and past the end keeps its distance */
+	if (target < 0) return target;
+	if (target >= (long) pass->addresses[count]) return 4 * (long) pass->program->count + (target - (long) pass->addresses[count]);
+	/* 2. Inside, the instruction that holds the target and the distance from its start */
+	owner = pass->owners[target / 2];
+	return 4 * (long) expandedIndex(pass, owner) + (target - (long) pass->addresses[owner]);
+}
+
+static void restoreRange(void *context, size_t begin, size_t end, int worker) {
+	ExpandPass *pass = context;
+	Program *program = pass->program;
+	size_t j;
+	pass->failed[worker] = pass->end[worker] = end;
+	/* Ranges are of the compressed code, j is an instruction there and i the same one now */
+	for (j = begin; j < end; ++j) {
+		size_t i = expandedIndex(pass, j);
+		uint32_t word = program->words[i];
+		long offset;
+		int branch = (word & 0x7F) == 0x63;
+		if (!branch && (word & 0x7F) != 0x6F) continue;
+		/* 1. Old target in the compressed code, new offset with 4 bytes per instruction */
+		offset = branch ? signedField(IMM_GATHER_SB(word), 13) : signedField(IMM_GATHER_UJ(word), 21);
+		offset = restoredTarget(pass, (long) pass->addresses[j] + offset) - 4 * (long) i;
+		/* 2. Code only grows, a 32-bit branch that was near the end of its reach may no longer get there */
+		if (offset != signedField((unsigned long) offset, branch ? 13 : 21)) {
+			if (pass->failed[worker] == end) pass->failed[worker] = j;
+			continue;
+		}
+		if (branch) program->words[i] = (uint32_t) ((word & ~0xFE000F80UL) | IMM_SCATTER_SB((unsigned long) offset & 0x1FFF));
+		else program->words[i] = (uint32_t) ((word & ~0xFFFFF000UL) | IMM_SCATTER_UJ((unsigned long) offset & 0x1FFFFF));
+	}
+}
+
+int restoreBranches(Program *program, const uint32_t *addresses) {
+	ExpandPass pass;
+	uint32_t *owners, *firsts = NULL;
+	size_t i, half, count = program->count;
+	/* 1. Instructions of the compressed code, where each one starts now if Zcmp runs have been unfolded */
+	if (program->isa & ISA_ZCMP) {
+		for (i = 0; i < program->count; ++i) count -= program->types[i] == FOLDED;
+	}
+	if (count != program->count) {
+		firsts = malloc(sizeof(uint32_t) * (count + 1));
+		if (firsts == NULL) return 1;
+		for (i = 0, half = 0; i < program->count; ++i) {
+			if (program->types[i] != FOLDED) firsts[half++] = (uint32_t) i;
+		}
+		firsts[count] = (uint32_t) program->count;
+	}
+	/* 2. Every 2 bytes of the compressed code point back to their instruction */
+	owners = malloc(sizeof(uint32_t) * (addresses[count] / 2 + 1));
+	if (owners == NULL) {
+		free(firsts);
+		return 1;
+	}
+	for (i = 0; i < count; ++i) {
+		for (half = addresses[i] / 2; half < addresses[i + 1] / 2; ++half) owners[half] = (uint32_t) i;
+	}
+	/* 3. The branches only read the tables and write their own word */
+	memset(&pass, 0, sizeof(pass));
+	pass.program = program;
+	pass.addresses = addresses;
+	pass.owners = owners;
+	pass.count = count;
+	pass.firsts = firsts;
+	parallelFor(program->threads, count, restoreRange, &pass);
+	free(owners);
+	/* 4. The unfolded runs are ordinary instructions from now on */
+	i = firstFailure(&pass, count);
+	program->invalid = i == count ? program->count : expandedIndex(&pass, i);
+	free(firsts);
+	if (firsts != NULL) memset(program->types, NON, program->count);
+	return i == count ? 0 : 3;
+}
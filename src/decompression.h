@@ -0,0 +1,95 @@
+#ifndef DECOMPRESSION_H
+#define DECOMPRESSION_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "utils.h"
+
+/* Number of 16-bit parcels, one entry each in the expansion table */
+#define PARCEL_COUNT (1 << 16)
+
+/*  const uint32_t *expansionTable(unsigned int isa):
+ *
+ *  Input:
+ *      unsigned int isa: Instruction set of the compressed code, ISA_* flags.
+ *
+ *  Output:
+ *      const uint32_t *:
+ *          result: PARCEL_COUNT entries, the 32-bit instruction every 16-bit parcel expands into, with
+ *                  the offset of a branch or jump as it is in the parcel. 0 for the lower half of
+ *                  32-bit instructions (lowest bits 11) and for every parcel compressWord() never
+ *                  produces for isa, so that an entry is exactly the instruction the parcel came from.
+ *          NULL: When the table cannot be allocated.
+ *      Built on the first call for isa from any thread, and kept until the process ends.
+ */
+const uint32_t *expansionTable(unsigned int isa);
+
+/*  Program *readFromParcels(const unsigned char *bytes, size_t length):
+ *
+ *  Input:
+ *      const unsigned char *bytes: Compressed code, little-endian 16-bit and 32-bit instructions.
+ *      size_t length: Number of bytes, a trailing partial instruction is ignored.
+ *
+ *  Output:
+ *      Program *:
+ *          result: One word per instruction, either a parcel (lowest bits not 11) or a 32-bit instruction.
+ *                  Text files of 16-digit and 32-digit lines come out the same from readFromFile().
+ *          NULL: When the program cannot be allocated.
+ */
+Program *readFromParcels(const unsigned char *bytes, size_t length);
+
+/*  Program *readParcelsFromBinary(FILE *in):
+ *
+ *  Same as readFromParcels() for a whole file (.bin), NULL when it cannot be read either.
+ */
+Program *readParcelsFromBinary(FILE *in);
+
+/*  uint32_t *parcelAddresses(const Program *program):
+ *
+ *  Input:
+ *      const Program *program: Words as read by readFromParcels() or readFromFile(), before expandParcels().
+ *
+ *  Output:
+ *      uint32_t *:
+ *          result: Byte offset of every instruction in the compressed code, plus its total size at [count].
+ *          NULL: When out of memory.
+ */
+uint32_t *parcelAddresses(const Program *program);
+
+/*  int expandParcels(Program *program):
+ *
+ *  Input:
+ *      Program *program: Words as read by readFromParcels(), every parcel is replaced by its 32-bit
+ *                        instruction with one load from expansionTable(program->isa). All types are NON afterwards.
+ *                        With ISA_ZCMP, a Zcmp parcel is replaced by the run compressSequence() folds into
+ *                        exactly it, the program grows by the extra instructions and those after the first
+ *                        of each run are FOLDED until restoreBranches().
+ *
+ *  Output:
+ *      int:
+ *          0: In most usual cases.
+ *          1: When out of memory.
+ *          2: When a parcel is not one the compressor produces, program->invalid is the first one.
+ */
+int expandParcels(Program *program);
+
+/*  int restoreBranches(Program *program, const uint32_t *addresses):
+ *
+ *  Input:
+ *      Program *program: After expandParcels().
+ *      const uint32_t *addresses: From parcelAddresses() before the expansion, one entry per instruction
+ *                                 that is not FOLDED.
+ *
+ *  Output:
+ *      Every branch and jump gets back the offset it had before compression, every instruction now
+ *      taking 4 bytes. Targets outside the code keep their distance from its start or end, as in mapOffset().
+ *      A target at a Zcmp instruction moves to the first instruction of its run, and all types are NON afterwards.
+ *      int:
+ *          0: In most usual cases.
+ *          1: When out of memory.
+ *          3: When a restored offset does not fit its instruction, program->invalid is the first one.
+ */
+int restoreBranches(Program *program, const uint32_t *addresses);
+
+#endif
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compression.h"
+#include "elf.h"
+#include "imm.h"
+#include "utils.h"
+
+/* Offsets of the fields we need in the ELF32 file header */
+#define EI_CLASS 4
+#define EI_DATA 5
+#define E_TYPE 0x10
+#define E_MACHINE 0x12
+#define E_ENTRY 0x18
+#define E_PHOFF 0x1C
+#define E_FLAGS 0x24
+#define E_PHENTSIZE 0x2A
+#define E_PHNUM 0x2C
+#define E_SHOFF 0x20
+#define E_SHENTSIZE 0x2E
+#define E_SHNUM 0x30
+#define E_SHSTRNDX 0x32
+#define ELF_HEADER_SIZE 0x34
+
+/* Offsets of the fields we need in an ELF32 section header */
+#define SH_NAME 0
+#define SH_TYPE 4
+#define SH_ADDR 12
+#define SH_OFFSET 16
+#define SH_SIZE 20
+#define SH_LINK 24
+#define SH_INFO 28
+#define SH_ENTSIZE 36
+#define SECTION_HEADER_SIZE 40
+
+/* Offsets of the fields we need in an ELF32 program header */
+#define P_OFFSET 4
+#define P_FILESZ 16
+#define P_MEMSZ 20
+#define PROGRAM_HEADER_SIZE 32
+
+/* Offsets of the fields in ELF32 symbols and relocations */
+#define ST_VALUE 4
+#define ST_SIZE 8
+#define ST_INFO 12
+#define ST_SHNDX 14
+#define SYMBOL_SIZE 16
+#define R_OFFSET 0
+#define R_INFO 4
+#define R_ADDEND 8
+#define REL_SIZE 8
+#define RELA_SIZE 12
+
+#define ELFCLASS32 1
+#define ELFDATA2LSB 1
+#define EM_RISCV 243
+#define ET_REL 1
+#define SHT_PROGBITS 1
+#define SHT_SYMTAB 2
+#define SHT_RELA 4
+#define SHT_REL 9
+#define SHT_DYNSYM 11
+#define STT_SECTION 3
+#define EF_RISCV_RVC 0x1
+
+/* Relocations of a call, which patch the auipc and the jalr after it */
+#define R_RISCV_CALL 18
+#define R_RISCV_CALL_PLT 19
+
+static unsigned long read16(const unsigned char *p) { return (unsigned long) p[0] | ((unsigned long) p[1] << 8); }
+
+static unsigned long read32(const unsigned char *p) { return read16(p) | (read16(p + 2) << 16); }
+
+static void write16(unsigned char *p, unsigned long value) {
+	p[0] = (unsigned char) (value & 0xFF);
+	p[1] = (unsigned char) ((value >> 8) & 0xFF);
+}
+
+static void write32(unsigned char *p, unsigned long value) {
+	write16(p, value & 0xFFFF);
+	write16(p + 2, (value >> 16) & 0xFFFF);
+}
+
+int isElf(const MappedFile *file) {
+	/* 1. Magic number: 0x7F 'E' 'L' 'F' */
+	return file->size >= 4 && file->data[0] == 0x7F && file->data[1] == 'E' && file->data[2] == 'L' && file->data[3] == 'F';
+}
+
+static int sectionInBounds(const MappedFile *file, unsigned long offset, unsigned long size) {
+	/* The content [offset, offset + size) must lie inside the file */
+	return offset <= file->size && size <= file->size - offset;
+}
+
+int findTextSection(const MappedFile *file, ElfSection *text) {
+	const unsigned char *data = file->data;
+	unsigned long shoff, shnum, shstrndx, i;
+	const unsigned char *names;
+	unsigned long namesSize;
+	/* 1. Only little-endian ELF32 RISC-V files are supported */
+	if (!isElf(file) || file->size < ELF_HEADER_SIZE) return 1;
+	if (data[EI_CLASS] != ELFCLASS32 || data[EI_DATA] != ELFDATA2LSB || read16(data + E_MACHINE) != EM_RISCV) return 1;
+	/* 2. Code built for the C extension may already hold 16-bit instructions */
+	if (read32(data + E_FLAGS) & EF_RISCV_RVC) return 3;
+	/* 3. Locate the section header table and the table of section names */
+	shoff = read32(data + E_SHOFF);
+	shnum = read16(data + E_SHNUM);
+	shstrndx = read16(data + E_SHSTRNDX);
+	if (read16(data + E_SHENTSIZE) != SECTION_HEADER_SIZE || !sectionInBounds(file, shoff, shnum * SECTION_HEADER_SIZE) || shstrndx >= shnum) return 1;
+	names = data + read32(data + shoff + shstrndx * SECTION_HEADER_SIZE + SH_OFFSET);
+	namesSize = read32(data + shoff + shstrndx * SECTION_HEADER_SIZE + SH_SIZE);
+	if (!sectionInBounds(file, (unsigned long) (names - data), namesSize)) return 1;
+	/* 4. Look for a section named .text */
+	for (i = 0; i < shnum; ++i) {
+		const unsigned char *header = data + shoff + i * SECTION_HEADER_SIZE;
+		unsigned long name = read32(header + SH_NAME);
+		if (read32(header + SH_TYPE) != SHT_PROGBITS || name + sizeof(".text") > namesSize) continue;
+		if (memcmp(names + name, ".text", sizeof(".text")) != 0) continue;
+		text->index = i;
+		text->offset = read32(header + SH_OFFSET);
+		text->size = read32(header + SH_SIZE);
+		text->address = read32(header + SH_ADDR);
+		if (!sectionInBounds(file, text->offset, text->size)) return 1;
+		return 0;
+	}
+	/* 5. No .text at all */
+	return 2;
+}
+
+int loadElf(FILE *in, MappedFile *file, ElfSection *text) {
+	int err;
+	/* 1. Map the whole file, sections can be anywhere */
+	if (mapFile(in, file, 1)) {
+		printf("Error: unable to read ELF file\n");
+		return 1;
+	}
+	/* 2. Find .text, and explain what is wrong if we cannot */
+	switch (err = findTextSection(file, text)) {
+		case 0:
+			return 0;
+		case 2:
+			printf("Error: no .text section in ELF file\n");
+			break;
+		case 3:
+			printf("Error: ELF file already uses compressed instructions\n");
+			break;
+		default:
+			printf("Error: not a little-endian ELF32 RISC-V file\n");
+			break;
+	}
+	unmapFile(file);
+	return err;
+}
+
+Program *readFromElf(FILE *in) {
+	MappedFile file;
+	ElfSection text;
+	Program *target;
+	/* 1. Locate .text */
+	if (loadElf(in, &file, &text)) return NULL;
+	/* 2. Feed its words to the usual pipeline */
+	target = readFromWords(file.data + text.offset, text.size);
+	unmapFile(&file);
+	return target;
+}
+
+int pinElfReferences(const MappedFile *file, const ElfSection *text, Program *program) {
+	const unsigned char *data = file->data;
+	unsigned long shoff = read32(data + E_SHOFF), shnum = read16(data + E_SHNUM), i, j;
+	int relocatable = read16(data + E_TYPE) == ET_REL;
+	uint8_t *pinned = calloc(program->count + 1, 1);
+	if (pinned == NULL) return 1;
+	/* 1. The linker still writes the fields of every instruction a relocation patches, in its 32-bit format and with its full reach */
+	for (i = 0; i < shnum; ++i) {
+		const unsigned char *header = data + shoff + i * SECTION_HEADER_SIZE;
+		unsigned long type = read32(header + SH_TYPE), offset = read32(header + SH_OFFSET), size = read32(header + SH_SIZE);
+		unsigned long entry = type == SHT_RELA ? RELA_SIZE : REL_SIZE;
+		if ((type != SHT_RELA && type != SHT_REL) || read32(header + SH_INFO) != text->index || !sectionInBounds(file, offset, size)) continue;
+		for (j = 0; j + entry <= size; j += entry) {
+			unsigned long place = read32(data + offset + j + R_OFFSET), kind = read32(data + offset + j + R_INFO) & 0xFF;
+			unsigned long index = (relocatable ? place : place - text->address) / 4;
+			if (index >= program->count) continue;
+			pinned[index] = 1;
+			if ((kind == R_RISCV_CALL || kind == R_RISCV_CALL_PLT) && index + 1 < program->count) pinned[index + 1] = 1;
+		}
+	}
+	/* 2. Addresses already resolved cannot be told apart from other numbers: those built by an auipc without a relocation,
+	 *    and in an executable any code pointer, which only an indirect jump other than ret (jalr x0, 0(ra)) can use */
+	for (i = 0; i < program->count; ++i) {
+		uint32_t word = program->words[i];
+		if ((word & 0x7F) == 0x17 && (!relocatable || !pinned[i])) break;
+		if ((word & 0x7F) == 0x67 && !relocatable && word != 0x8067) break;
+		/* 3. So are branches and jumps past the end of .text: the sections there keep their addresses, but the
+		 *    relocation would move the target along with the end of the code. The end itself is only a label of
+		 *    .text in a relocatable object, in an executable it is where the next section starts */
+		if (((word & 0x7F) == 0x63 || (word & 0x7F) == 0x6F) && !pinned[i]) {
+			long offset = (word & 0x7F) == 0x63 ? (long) (IMM_GATHER_SB(word) ^ 0x1000) - 0x1000 : (long) (IMM_GATHER_UJ(word) ^ 0x100000) - 0x100000;
+			long target = 4 * (long) i + offset, end = 4 * (long) program->count;
+			if (target > end || (target == end && !relocatable)) break;
+		}
+	}
+	if (i != program->count) {
+		free(pinned);
+		return 2;
+	}
+	free(program->pinned);
+	program->pinned = pinned;
+	return 0;
+}
+
+/* Everything needed to move an address of the old .text to the new one */
+typedef struct AddressRemap {
+	/* New offset of each instruction, and the new size at [count] */
+	const uint32_t *map;
+	size_t count;
+	/* Where .text starts, and its old size */
+	unsigned long address;
+	unsigned long oldSize;
+} AddressRemap;
+
+static unsigned long remapOffset(const AddressRemap *remap, unsigned long offset) { return (unsigned long) mapOffset(remap->map, remap->count, (long) offset); }
+
+static unsigned long remapAddress(const AddressRemap *remap, unsigned long address) {
+	/* Only addresses inside .text (or right at its end) move */
+	if (address < remap->address || address - remap->address > remap->oldSize) return address;
+	return remap->address + remapOffset(remap, address - remap->address);
+}
+
+static void remapSymbols(unsigned char *image, unsigned long offset, unsigned long size, const ElfSection *text, const AddressRemap *remap, int relocatable) {
+	unsigned long i;
+	/* 1. Only symbols defined in .text move */
+	for (i = 0; i + SYMBOL_SIZE <= size; i += SYMBOL_SIZE) {
+		unsigned char *symbol = image + offset + i;
+		unsigned long value = read32(symbol + ST_VALUE), length = read32(symbol + ST_SIZE), start, end;
+		if (read16(symbol + ST_SHNDX) != text->index) continue;
+		/* 2. Relocatable objects hold offsets into the section, the others hold addresses */
+		if (relocatable) {
+			start = remapOffset(remap, value);
+			end = remapOffset(remap, value + length);
+		} else {
+			start = remapAddress(remap, value);
+			end = remapAddress(remap, value + length);
+		}
+		write32(symbol + ST_VALUE, start);
+		/* 3. The size of a function shrinks with its code */
+		if (length != 0) write32(symbol + ST_SIZE, end - start);
+	}
+}
+
+static void remapRelocations(unsigned char *image, const MappedFile *file, const unsigned char *header, const ElfSection *text, const AddressRemap *remap,
+                             int relocatable) {
+	unsigned long offset = read32(header + SH_OFFSET), size = read32(header + SH_SIZE), i;
+	unsigned long entry = read32(header + SH_TYPE) == SHT_RELA ? RELA_SIZE : REL_SIZE;
+	const unsigned char *symbols = NULL;
+	unsigned long symbolsSize = 0;
+	/* 1. The symbol table of the input tells whether a relocation is relative to a place in .text */
+	{
+		unsigned long link = read32(header + SH_LINK), shnum = read16(file->data + E_SHNUM);
+		if (link != 0 && link < shnum) {
+			const unsigned char *linked = file->data + read32(file->data + E_SHOFF) + link * SECTION_HEADER_SIZE;
+			if (sectionInBounds(file, read32(linked + SH_OFFSET), read32(linked + SH_SIZE))) {
+				symbols = file->data + read32(linked + SH_OFFSET);
+				symbolsSize = read32(linked + SH_SIZE);
+			}
+		}
+	}
+	for (i = 0; i + entry <= size; i += entry) {
+		unsigned char *relocation = image + offset + i;
+		unsigned long symbol = read32(relocation + R_INFO) >> 8;
+		/* 2. Relocations applied to .text follow the instruction they patch, which pinElfReferences() kept 32-bit */
+		if (read32(header + SH_INFO) == text->index) {
+			unsigned long place = read32(relocation + R_OFFSET);
+			write32(relocation + R_OFFSET, relocatable ? remapOffset(remap, place) : remapAddress(remap, place));
+		}
+		/* 3. An addend relative to a symbol of .text (its section symbol too) is a distance inside the old code */
+		if (entry == RELA_SIZE && symbols != NULL && (symbol + 1) * SYMBOL_SIZE <= symbolsSize) {
+			const unsigned char *target = symbols + symbol * SYMBOL_SIZE;
+			if (read16(target + ST_SHNDX) == text->index) {
+				unsigned long value = read32(target + ST_VALUE), place = (value + read32(relocation + R_ADDEND)) & 0xFFFFFFFFUL;
+				if (relocatable && place <= remap->oldSize) write32(relocation + R_ADDEND, remapOffset(remap, place) - remapOffset(remap, value));
+				else if (!relocatable) write32(relocation + R_ADDEND, remapAddress(remap, place) - remapAddress(remap, value));
+			}
+		}
+	}
+}
+
+int writeToElf(FILE *out, const MappedFile *file, const ElfSection *text, const Program *program) {
+	AddressRemap remap;
+	uint32_t *map;
+	unsigned char *image;
+	unsigned long i, shoff = read32(file->data + E_SHOFF), shnum = read16(file->data + E_SHNUM), delta;
+	int relocatable = read16(file->data + E_TYPE) == ET_REL, err = 0;
+	/* 1. Check validation */
+	if (out == NULL || program == NULL) return 1;
+	/* 2. The old-to-new map of every code address */
+	remap.count = program->count;
+	remap.address = text->address;
+	remap.oldSize = text->size;
+	map = buildAddressMap(program);
+	image = malloc(file->size);
+	if (map == NULL || image == NULL) {
+		free(map);
+		free(image);
+		return 2;
+	}
+	remap.map = map;
+	delta = text->size - map[remap.count];
+	/* 3. The new image keeps every other section where it was, .text shrinks and the rest of it is zero padding */
+	memcpy(image, file->data, file->size);
+	memset(image + text->offset, 0, text->size);
+	encodeToBytes(program, image + text->offset);
+	write32(image + shoff + text->index * SECTION_HEADER_SIZE + SH_SIZE, map[remap.count]);
+	write32(image + E_FLAGS, read32(image + E_FLAGS) | EF_RISCV_RVC);
+	/* 4. Entry point */
+	if (!relocatable) write32(image + E_ENTRY, remapAddress(&remap, read32(image + E_ENTRY)));
+	/* 5. A segment whose file content ends with .text shrinks with it */
+	{
+		unsigned long phoff = read32(file->data + E_PHOFF), phnum = read16(file->data + E_PHNUM);
+		if (phnum != 0 && read16(file->data + E_PHENTSIZE) == PROGRAM_HEADER_SIZE && sectionInBounds(file, phoff, phnum * PROGRAM_HEADER_SIZE)) {
+			for (i = 0; i < phnum; ++i) {
+				unsigned char *segment = image + phoff + i * PROGRAM_HEADER_SIZE;
+				unsigned long fileSize = read32(segment + P_FILESZ), memorySize = read32(segment + P_MEMSZ);
+				if (fileSize == 0 || read32(segment + P_OFFSET) + fileSize != text->offset + text->size) continue;
+				write32(segment + P_FILESZ, fileSize - delta);
+				if (memorySize == fileSize) write32(segment + P_MEMSZ, memorySize - delta);
+			}
+		}
+	}
+	/* 6. Symbols and relocations */
+	for (i = 0; i < shnum; ++i) {
+		const unsigned char *header = file->data + shoff + i * SECTION_HEADER_SIZE;
+		unsigned long type = read32(header + SH_TYPE), offset = read32(header + SH_OFFSET), size = read32(header + SH_SIZE);
+		if (!sectionInBounds(file, offset, size)) continue;
+		if (type == SHT_SYMTAB || type == SHT_DYNSYM) remapSymbols(image, offset, size, text, &remap, relocatable);
+		else if (type == SHT_RELA || type == SHT_REL) remapRelocations(image, file, header, text, &remap, relocatable);
+	}
+	/* 7. Write out the new image */
+	if (fwrite(image, 1, file->size, out) != file->size) err = 2;
+	free(image);
+	free(map);
+	return err;
+}
@@ -0,0 +1,115 @@
+#ifndef ELF_H
+#define ELF_H
+
+#include <stdio.h>
+
+#include "utils.h"
+
+/* Where a section lives, taken from its ELF32 section header */
+typedef struct ElfSection {
+	/* Index in the section header table */
+	unsigned long index;
+	/* Offset of the content in the file */
+	unsigned long offset;
+	/* Size of the content in bytes */
+	unsigned long size;
+	/* Virtual address of the section (0 in relocatable objects) */
+	unsigned long address;
+} ElfSection;
+
+/*  int isElf(const MappedFile *file):
+ *
+ *  Input:
+ *      const MappedFile *file: Content of a file.
+ *
+ *  Output:
+ *      int:
+ *          0: When the file does not start with the ELF magic number.
+ *          1: When it does.
+ */
+int isElf(const MappedFile *file);
+
+/*  int findTextSection(const MappedFile *file, ElfSection *text):
+ *
+ *  Input:
+ *      const MappedFile *file: Content of a little-endian ELF32 RISC-V file.
+ *      ElfSection *text: Receives the location of the .text section.
+ *
+ *  Output:
+ *      int:
+ *          0: When .text is found.
+ *          1: When the file is not a little-endian ELF32 RISC-V file, or its headers are out of bounds.
+ *          2: When there is no .text section.
+ *          3: When the file is already built with compressed instructions.
+ */
+int findTextSection(const MappedFile *file, ElfSection *text);
+
+/*  int loadElf(FILE *in, MappedFile *file, ElfSection *text):
+ *
+ *  Input:
+ *      FILE *in: Valid readable filestream holding an ELF32 RISC-V file.
+ *      MappedFile *file: Receives the content, release it with unmapFile().
+ *      ElfSection *text: Receives the location of the .text section.
+ *
+ *  Output:
+ *      int:
+ *          0: When the file is read and .text is found.
+ *          otherwise: An error has been printed and nothing needs to be released.
+ */
+int loadElf(FILE *in, MappedFile *file, ElfSection *text);
+
+/*  Program *readFromElf(FILE *in):
+ *
+ *  Input:
+ *      FILE *in: Valid readable filestream holding an ELF32 RISC-V file.
+ *
+ *  Output:
+ *      Program *:
+ *          result: The .text section, same as readFromFile().
+ *          NULL: When the file cannot be read or has no usable .text section.
+ */
+Program *readFromElf(FILE *in);
+
+/*  int pinElfReferences(const MappedFile *file, const ElfSection *text, Program *program):
+ *
+ *  Input:
+ *      const MappedFile *file, const ElfSection *text: The input file, as returned by loadElf().
+ *      Program *program: All instructions of .text, before primaryCompression().
+ *
+ *  Output:
+ *      Pins (program->pinned) every instruction a relocation patches, and the jalr of a call, so that they
+ *      stay 32-bit: an external jal compressed to c.jal would reach only 2 KiB once linked. Addresses nothing
+ *      points out cannot follow the shrinking code, so the file is refused when .text holds an auipc without a
+ *      relocation (an executable: any auipc), when an executable holds an indirect jump other than ret,
+ *      through which code pointers built with lui or stored in data are used, or when a branch or jal without
+ *      a relocation targets a later section, which keeps its address while the end of .text moves.
+ *
+ *      int:
+ *          0: When .text can be compressed.
+ *          1: When out of memory.
+ *          2: When .text holds addresses that cannot be relocated.
+ */
+int pinElfReferences(const MappedFile *file, const ElfSection *text, Program *program);
+
+/*  int writeToElf(FILE *out, const MappedFile *file, const ElfSection *text, const Program *program):
+ *
+ *  Input:
+ *      FILE *out: Valid writable filestream.
+ *      const MappedFile *file, const ElfSection *text: The input file, as returned by loadElf().
+ *      const Program *program: All instructions of .text, after primaryCompression() and confirmAddress().
+ *
+ *  Output:
+ *      Writes a copy of the input with the compressed .text. Every other section stays at the same
+ *      offset and address, the bytes freed at the end of .text become zero padding. Symbols defined
+ *      in .text, the entry point, relocations against .text, addends relative to the .text section
+ *      symbol and the size of the segment ending with .text are moved to the new addresses.
+ *      Instructions patched by relocations must have been pinned by pinElfReferences(), so they keep their format.
+ *
+ *      int:
+ *          0: In most usual cases.
+ *          1: When some input values are invalid.
+ *          2: When memory cannot be allocated or the output cannot be written.
+ */
+int writeToElf(FILE *out, const MappedFile *file, const ElfSection *text, const Program *program);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef IMM_H
+#define IMM_H
+
+/*  Scrambled immediate fields, one pair of macros per layout:
+ *
+ *  IMM_SCATTER_<layout>(imm) places an immediate into its bits of the instruction, other bits are 0.
+ *  IMM_GATHER_<layout>(instruction) takes the immediate back out of an instruction, other bits are ignored.
+ *
+ *  Both expand to plain shifts and masks so the compiler can fold them into the caller. The argument is
+ *  evaluated more than once and must have no side effects.
+ */
+
+#define IMM_ARG(x) ((unsigned long) (x))
+
+/* beq / bne ...: imm[12|10:5] at 31 ~ 25, imm[4:1|11] at 11 ~ 7 */
+#define IMM_SCATTER_SB(imm) (((IMM_ARG(imm) & (1 << 12)) >> 12 << 31) | ((IMM_ARG(imm) & 0x7E0) >> 5 << 25) | ((IMM_ARG(imm) & 0x1E) >> 1 << 8) | \
+	((IMM_ARG(imm) & (1 << 11)) >> 11 << 7))
+#define IMM_GATHER_SB(instruction) ((((IMM_ARG(instruction) >> 31) & 1) << 12) | ((IMM_ARG(instruction) & 0x80) >> 7 << 11) | \
+	((IMM_ARG(instruction) & 0x7E000000) >> 20) | ((IMM_ARG(instruction) & 0xF00) >> 7))
+
+/* jal: imm[20|10:1|11|19:12] at 31 ~ 12 */
+#define IMM_SCATTER_UJ(imm) (((IMM_ARG(imm) & (1UL << 20)) >> 20 << 31) | ((IMM_ARG(imm) & 0x7FE) >> 1 << 21) | \
+	((IMM_ARG(imm) & (1 << 11)) >> 11 << 20) | ((IMM_ARG(imm) & 0xFF000) >> 12 << 12))
+#define IMM_GATHER_UJ(instruction) (((IMM_ARG(instruction) & 0x80000000) >> 11) | (((IMM_ARG(instruction) >> 21) & 0x3FF) << 1) | \
+	(((IMM_ARG(instruction) >> 20) & 1) << 11) | (((IMM_ARG(instruction) >> 12) & 0xFF) << 12))
+
+/* c.beqz / c.bnez: offset[8|4:3] at 12 ~ 10, offset[7:6|2:1|5] at 6 ~ 2 */
+#define IMM_SCATTER_CB(imm) (((IMM_ARG(imm) & 0x100) >> 8 << 12) | ((IMM_ARG(imm) & 0x18) >> 3 << 10) | ((IMM_ARG(imm) & 0xC0) >> 6 << 5) | \
+	((IMM_ARG(imm) & 0x6) >> 1 << 3) | ((IMM_ARG(imm) & 0x20) >> 5 << 2))
+#define IMM_GATHER_CB(instruction) (((IMM_ARG(instruction) >> 12 & 1) << 8) | ((IMM_ARG(instruction) >> 10 & 0x3) << 3) | \
+	((IMM_ARG(instruction) >> 5 & 0x3) << 6) | ((IMM_ARG(instruction) >> 3 & 0x3) << 1) | ((IMM_ARG(instruction) >> 2 & 1) << 5))
+
+/* c.j / c.jal: offset[11|4|9:8|10|6|7|3:1|5] at 12 ~ 2 */
+#define IMM_SCATTER_CJ(imm) (((IMM_ARG(imm) & 0x800) >> 11 << 12) | ((IMM_ARG(imm) & 0x10) >> 4 << 11) | ((IMM_ARG(imm) & 0x300) >> 8 << 9) | \
+	((IMM_ARG(imm) & 0x400) >> 10 << 8) | ((IMM_ARG(imm) & 0x40) >> 6 << 7) | ((IMM_ARG(imm) & 0x80) >> 7 << 6) | ((IMM_ARG(imm) & 0xE) >> 1 << 3) | \
+	((IMM_ARG(imm) & 0x20) >> 5 << 2))
+#define IMM_GATHER_CJ(instruction) (((IMM_ARG(instruction) >> 12 & 1) << 11) | ((IMM_ARG(instruction) >> 11 & 1) << 4) | \
+	((IMM_ARG(instruction) >> 9 & 0x3) << 8) | ((IMM_ARG(instruction) >> 8 & 1) << 10) | ((IMM_ARG(instruction) >> 7 & 1) << 6) | \
+	((IMM_ARG(instruction) >> 6 & 1) << 7) | ((IMM_ARG(instruction) >> 3 & 0x7) << 1) | ((IMM_ARG(instruction) >> 2 & 1) << 5))
+
+/* c.lw / c.sw, in words: offset[5:3] at 12 ~ 10, offset[2|6] at 6 ~ 5 */
+#define IMM_SCATTER_CLS(imm) (((IMM_ARG(imm) & 0xE) >> 1 << 10) | ((IMM_ARG(imm) & 0x1) << 6) | ((IMM_ARG(imm) & 0x10) >> 4 << 5))
+#define IMM_GATHER_CLS(instruction) (((IMM_ARG(instruction) >> 10 & 0x7) << 1) | (IMM_ARG(instruction) >> 6 & 1) | ((IMM_ARG(instruction) >> 5 & 1) << 4))
+
+/* c.lwsp, in bytes: offset[5] at 12, offset[4:2|7:6] at 6 ~ 2 */
+#define IMM_SCATTER_CIL(imm) (((IMM_ARG(imm) & 0x20) >> 5 << 12) | ((IMM_ARG(imm) & 0x1C) >> 2 << 4) | ((IMM_ARG(imm) & 0xC0) >> 6 << 2))
+#define IMM_GATHER_CIL(instruction) (((IMM_ARG(instruction) >> 12 & 1) << 5) | ((IMM_ARG(instruction) >> 4 & 0x7) << 2) | \
+	((IMM_ARG(instruction) >> 2 & 0x3) << 6))
+
+/* c.swsp, in bytes: offset[5:2|7:6] at 12 ~ 7 */
+#define IMM_SCATTER_CSS(imm) (((IMM_ARG(imm) & 0x3C) >> 2 << 9) | ((IMM_ARG(imm) & 0xC0) >> 6 << 7))
+#define IMM_GATHER_CSS(instruction) (((IMM_ARG(instruction) >> 9 & 0xF) << 2) | ((IMM_ARG(instruction) >> 7 & 0x3) << 6))
+
+/* c.addi16sp: nzimm[9] at 12, nzimm[4|6|8:7|5] at 6 ~ 2 */
+#define IMM_SCATTER_CIS(imm) (((IMM_ARG(imm) & 0x200) >> 9 << 12) | ((IMM_ARG(imm) & 0x10) >> 4 << 6) | ((IMM_ARG(imm) & 0x40) >> 6 << 5) | \
+	((IMM_ARG(imm) & 0x180) >> 7 << 3) | ((IMM_ARG(imm) & 0x20) >> 5 << 2))
+#define IMM_GATHER_CIS(instruction) (((IMM_ARG(instruction) >> 12 & 1) << 9) | ((IMM_ARG(instruction) >> 6 & 1) << 4) | \
+	((IMM_ARG(instruction) >> 5 & 1) << 6) | ((IMM_ARG(instruction) >> 3 & 0x3) << 7) | ((IMM_ARG(instruction) >> 2 & 1) << 5))
+
+/* c.addi4spn: nzuimm[5:4|9:6|2|3] at 12 ~ 5 */
+#define IMM_SCATTER_CIW(imm) (((IMM_ARG(imm) & 0x30) >> 4 << 11) | ((IMM_ARG(imm) & 0x3C0) >> 6 << 7) | ((IMM_ARG(imm) & 0x4) >> 2 << 6) | \
+	((IMM_ARG(imm) & 0x8) >> 3 << 5))
+#define IMM_GATHER_CIW(instruction) (((IMM_ARG(instruction) >> 11 & 0x3) << 4) | ((IMM_ARG(instruction) >> 7 & 0xF) << 6) | \
+	((IMM_ARG(instruction) >> 6 & 1) << 2) | ((IMM_ARG(instruction) >> 5 & 1) << 3))
+
+/* c.ld / c.sd, in bytes: offset[5:3] at 12 ~ 10, offset[7:6] at 6 ~ 5 */
+#define IMM_SCATTER_CLD(imm) (((IMM_ARG(imm) & 0x38) >> 3 << 10) | ((IMM_ARG(imm) & 0xC0) >> 6 << 5))
+#define IMM_GATHER_CLD(instruction) (((IMM_ARG(instruction) >> 10 & 0x7) << 3) | ((IMM_ARG(instruction) >> 5 & 0x3) << 6))
+
+/* c.ldsp, in bytes: offset[5] at 12, offset[4:3|8:6] at 6 ~ 2 */
+#define IMM_SCATTER_CILD(imm) (((IMM_ARG(imm) & 0x20) >> 5 << 12) | ((IMM_ARG(imm) & 0x18) >> 3 << 5) | ((IMM_ARG(imm) & 0x1C0) >> 6 << 2))
+#define IMM_GATHER_CILD(instruction) (((IMM_ARG(instruction) >> 12 & 1) << 5) | ((IMM_ARG(instruction) >> 5 & 0x3) << 3) | \
+	((IMM_ARG(instruction) >> 2 & 0x7) << 6))
+
+/* c.sdsp, in bytes: offset[5:3|8:6] at 12 ~ 7 */
+#define IMM_SCATTER_CSSD(imm) (((IMM_ARG(imm) & 0x38) >> 3 << 10) | ((IMM_ARG(imm) & 0x1C0) >> 6 << 7))
+#define IMM_GATHER_CSSD(instruction) (((IMM_ARG(instruction) >> 10 & 0x7) << 3) | ((IMM_ARG(instruction) >> 7 & 0x7) << 6))
+
+#endif
@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "parallel.h"
+
+/* One range of parallelFor() */
+typedef struct RangeTask {
+	RangeFunction *function;
+	void *context;
+	size_t begin, end;
+	int worker;
+	/* Whether the range runs on its own thread */
+	int started;
+	pthread_t thread;
+} RangeTask;
+
+/* Items [next, end) still waiting in the queue of one worker of parallelTasks() */
+typedef struct StealQueue {
+	pthread_mutex_t lock;
+	size_t next, end;
+} StealQueue;
+
+typedef struct StealPool {
+	TaskFunction *function;
+	void *context;
+	int threads;
+	StealQueue queues[MAX_THREADS];
+} StealPool;
+
+static void *runTask(void *argument) {
+	RangeTask *task = argument;
+	task->function(task->context, task->begin, task->end, task->worker);
+	return NULL;
+}
+
+size_t rangeBegin(int threads, size_t count, int worker) {
+	/* 1. Split without overflow, the remainder is spread over the ranges */
+	return count / (size_t) threads * (size_t) worker + count % (size_t) threads * (size_t) worker / (size_t) threads;
+}
+
+void parallelFor(int threads, size_t count, RangeFunction *function, void *context) {
+	RangeTask tasks[MAX_THREADS];
+	int i;
+	/* 1. Ranges are never empty, a single range needs no thread at all */
+	if (threads > MAX_THREADS) threads = MAX_THREADS;
+	if ((size_t) threads > count) threads = (int) count;
+	if (threads <= 1) {
+		function(context, 0, count, 0);
+		return;
+	}
+	/* 2. Start a thread for every range but the first */
+	for (i = 0; i < threads; ++i) {
+		tasks[i].function = function;
+		tasks[i].context = context;
+		tasks[i].begin = rangeBegin(threads, count, i);
+		tasks[i].end = rangeBegin(threads, count, i + 1);
+		tasks[i].worker = i;
+		tasks[i].started = i != 0 && pthread_create(&tasks[i].thread, NULL, runTask, &tasks[i]) == 0;
+	}
+	/* 3. The calling thread takes the first range, and every range that could not get a thread */
+	for (i = 0; i < threads; ++i) {
+		if (!tasks[i].started) runTask(&tasks[i]);
+	}
+	/* 4. Wait for the others */
+	for (i = 1; i < threads; ++i) {
+		if (tasks[i].started) pthread_join(tasks[i].thread, NULL);
+	}
+}
+
+/* Take the next item of a queue, returns 0 when it is empty */
+static int takeItem(StealQueue *queue, size_t *item) {
+	int found;
+	pthread_mutex_lock(&queue->lock);
+	found = queue->next < queue->end;
+	if (found) *item = queue->next++;
+	pthread_mutex_unlock(&queue->lock);
+	return found;
+}
+
+/* Move the back half of the queue of another worker into an empty one, returns 0 when all are empty */
+static int stealItems(StealPool *pool, int thief) {
+	int i;
+	for (i = 1; i < pool->threads; ++i) {
+		StealQueue *victim = &pool->queues[(thief + i) % pool->threads];
+		size_t begin = 0, end = 0;
+		pthread_mutex_lock(&victim->lock);
+		if (victim->next < victim->end) {
+			/* The victim keeps the front, an only item goes to the thief */
+			begin = victim->end - (victim->end - victim->next + 1) / 2;
+			end = victim->end;
+			victim->end = begin;
+		}
+		pthread_mutex_unlock(&victim->lock);
+		if (begin != end) {
+			/* Nobody steals from an empty queue, so the range cannot be missed meanwhile */
+			pthread_mutex_lock(&pool->queues[thief].lock);
+			pool->queues[thief].next = begin;
+			pool->queues[thief].end = end;
+			pthread_mutex_unlock(&pool->queues[thief].lock);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void runWorker(void *context, size_t begin, size_t end, int worker) {
+	StealPool *pool = context;
+	size_t item;
+	(void) begin;
+	(void) end;
+	/* Items never create items, so once every queue is empty the work is done */
+	do {
+		while (takeItem(&pool->queues[worker], &item)) pool->function(pool->context, item, worker);
+	} while (stealItems(pool, worker));
+}
+
+void parallelTasks(int threads, size_t count, TaskFunction *function, void *context) {
+	StealPool *pool;
+	size_t i;
+	int k;
+	/* 1. Same limits as parallelFor(), and no pool without a second worker */
+	if (threads > MAX_THREADS) threads = MAX_THREADS;
+	if ((size_t) threads > count) threads = (int) count;
+	pool = threads > 1 ? malloc(sizeof(StealPool)) : NULL;
+	if (pool == NULL) {
+		for (i = 0; i < count; ++i) function(context, i, 0);
+		return;
+	}
+	/* 2. Every worker starts on its own range */
+	pool->function = function;
+	pool->context = context;
+	pool->threads = threads;
+	for (k = 0; k < threads; ++k) {
+		pthread_mutex_init(&pool->queues[k].lock, NULL);
+		pool->queues[k].next = rangeBegin(threads, count, k);
+		pool->queues[k].end = rangeBegin(threads, count, k + 1);
+	}
+	/* 3. One range of parallelFor() per worker */
+	parallelFor(threads, (size_t) threads, runWorker, pool);
+	for (k = 0; k < threads; ++k) pthread_mutex_destroy(&pool->queues[k].lock);
+	free(pool);
+}
+
+int onlineProcessors(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	if (count < 1) return 1;
+	return count > MAX_THREADS ? MAX_THREADS : (int) count;
+}
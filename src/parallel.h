@@ -0,0 +1,61 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+/* Most worker threads -j accepts */
+#define MAX_THREADS 256
+
+/* Work on the instructions [begin, end), worker is the index of the range (0 ~ threads - 1) */
+typedef void RangeFunction(void *context, size_t begin, size_t end, int worker);
+
+/* Work on item task, worker is the index of the thread (0 ~ threads - 1) */
+typedef void TaskFunction(void *context, size_t task, int worker);
+
+/*  void parallelFor(int threads, size_t count, RangeFunction *function, void *context):
+ *
+ *  Input:
+ *      int threads: Number of ranges, every range but the first runs on its own pthread.
+ *      size_t count: Number of items, split into contiguous ranges of (almost) equal size.
+ *      RangeFunction *function: Called once per range, ranges never overlap.
+ *      void *context: Passed to every call.
+ *
+ *  Output:
+ *      Returns when every range is done. Range k is always [k * count / threads, (k + 1) * count / threads),
+ *      so the split only depends on count and threads. A range whose thread cannot be created runs
+ *      on the calling thread instead, the work is always done.
+ */
+void parallelFor(int threads, size_t count, RangeFunction *function, void *context);
+
+/*  size_t rangeBegin(int threads, size_t count, int worker):
+ *
+ *  Output:
+ *      size_t:
+ *          result: First item of range (worker) in parallelFor(), range (threads) is the end.
+ */
+size_t rangeBegin(int threads, size_t count, int worker);
+
+/*  void parallelTasks(int threads, size_t count, TaskFunction *function, void *context):
+ *
+ *  Input:
+ *      int threads: Number of workers, every worker but the first runs on its own pthread.
+ *      size_t count: Number of items, of any size each.
+ *      TaskFunction *function: Called once per item.
+ *      void *context: Passed to every call.
+ *
+ *  Output:
+ *      Returns when every item is done. Every worker starts on the range parallelFor() would give it and
+ *      takes its items from the front. A worker that runs out steals the back half of what another one
+ *      has left, so a long item only holds up its own worker and the rest keeps moving.
+ */
+void parallelTasks(int threads, size_t count, TaskFunction *function, void *context);
+
+/*  int onlineProcessors(void):
+ *
+ *  Output:
+ *      int:
+ *          result: Number of processors online, 1 to MAX_THREADS.
+ */
+int onlineProcessors(void);
+
+#endif
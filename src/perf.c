@@ -0,0 +1,143 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "perf.h"
+
+/* Names in the table, in the order of the enums */
+static const char *const phaseNames[PHASE_COUNT] = {"parse", "classify", "relocate", "write"};
+static const char *const counterNames[COUNTER_COUNT] = {"cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses"};
+
+/* Open one event of the calling thread, stopped, -1 when it cannot be counted */
+static int openEvent(Counter counter) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	switch (counter) {
+		case COUNTER_CYCLES:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case COUNTER_INSTRUCTIONS:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case COUNTER_BRANCH_MISSES:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+			break;
+		case COUNTER_L1D_MISSES:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+			break;
+		default:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+			break;
+	}
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	attr.disabled = 1;
+	/* User space only, which needs no privileges up to perf_event_paranoid 2, and the -j threads too */
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.inherit = 1;
+	return (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* Value, time enabled and time running of an event, 0 on success */
+static int readEvent(int fd, uint64_t values[3]) {
+	return read(fd, values, 3 * sizeof(uint64_t)) != (ssize_t) (3 * sizeof(uint64_t));
+}
+
+unsigned int openCounters(PerfCounters *counters, FILE *messages) {
+	int k, error = 0;
+	/* 1. Every event on its own, so that one refused event does not take the others along */
+	counters->mask = 0;
+	for (k = 0; k < COUNTER_COUNT; ++k) {
+		counters->fds[k] = openEvent((Counter) k);
+		if (counters->fds[k] < 0) {
+			error = errno;
+			continue;
+		}
+		counters->mask |= 1u << k;
+	}
+	if (counters->mask == 0) {
+		fprintf(messages, "Warning: no hardware counters (%s), check /proc/sys/kernel/perf_event_paranoid or the container's seccomp profile\n", strerror(error));
+		return 0;
+	}
+	/* 2. Start counting, the first lap begins here */
+	for (k = 0; k < COUNTER_COUNT; ++k) {
+		if (counters->fds[k] < 0) continue;
+		ioctl(counters->fds[k], PERF_EVENT_IOC_ENABLE, 0);
+		if (readEvent(counters->fds[k], counters->marks[k]) != 0) memset(counters->marks[k], 0, sizeof(counters->marks[k]));
+	}
+	return counters->mask;
+}
+
+void lapCounters(PerfCounters *counters, Stats *stats, Phase phase) {
+	int k;
+	stats->counterMask = counters->mask;
+	for (k = 0; k < COUNTER_COUNT; ++k) {
+		uint64_t values[3], value, enabled, running;
+		stats->counters[phase][k] = 0;
+		if (counters->fds[k] < 0 || readEvent(counters->fds[k], values) != 0) continue;
+		/* 1. Differences since the previous lap */
+		value = values[0] - counters->marks[k][0];
+		enabled = values[1] - counters->marks[k][1];
+		running = values[2] - counters->marks[k][2];
+		memcpy(counters->marks[k], values, sizeof(values));
+		/* 2. Extrapolate when the event was only counted part of the time */
+		if (running > 0 && running < enabled) value = (uint64_t) ((double) value * (double) enabled / (double) running);
+		stats->counters[phase][k] = value;
+	}
+}
+
+void closeCounters(PerfCounters *counters) {
+	int k;
+	if (counters->mask == 0) return;
+	for (k = 0; k < COUNTER_COUNT; ++k)
+		if (counters->fds[k] >= 0) close(counters->fds[k]);
+	counters->mask = 0;
+}
+
+/* Print one row of events per instruction into cursor */
+static char *appendRow(char *cursor, const char *name, const uint64_t *counts, unsigned int mask, size_t instructions) {
+	int k;
+	cursor += sprintf(cursor, "%-10s", name);
+	for (k = 0; k < COUNTER_COUNT; ++k) {
+		if (mask >> k & 1) cursor += sprintf(cursor, " %14.3f", instructions ? (double) counts[k] / (double) instructions : 0.0);
+		else cursor += sprintf(cursor, " %14s", "-");
+	}
+	*cursor++ = '\n';
+	return cursor;
+}
+
+int writeCounters(FILE *out, const Stats *stats, const char *input) {
+	uint64_t total[COUNTER_COUNT];
+	char *table, *cursor;
+	int i, k, err;
+	/* 1. Room for the name and every row */
+	table = malloc(strlen(input) + 16 * (COUNTER_COUNT + 1) * (PHASE_COUNT + 2) + 128);
+	if (table == NULL) return 1;
+	cursor = table + sprintf(table, "%s: %lu instructions, events per instruction\n", input, (unsigned long) stats->instructions);
+	cursor += sprintf(cursor, "%-10s", "phase");
+	for (k = 0; k < COUNTER_COUNT; ++k) cursor += sprintf(cursor, " %14s", counterNames[k]);
+	*cursor++ = '\n';
+	/* 2. One row per phase, then the sum */
+	memset(total, 0, sizeof(total));
+	for (i = 0; i < PHASE_COUNT; ++i) {
+		cursor = appendRow(cursor, phaseNames[i], stats->counters[i], stats->counterMask, stats->instructions);
+		for (k = 0; k < COUNTER_COUNT; ++k) total[k] += stats->counters[i][k];
+	}
+	cursor = appendRow(cursor, "total", total, stats->counterMask, stats->instructions);
+	*cursor = '\0';
+	err = fputs(table, out) == EOF || fflush(out) != 0;
+	free(table);
+	return err;
+}
@@ -0,0 +1,74 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "stats.h"
+
+/* Hardware counters of the calling thread and of the threads it starts, one per Counter */
+typedef struct PerfCounters {
+	/* File descriptor of each event, -1 when it cannot be counted */
+	int fds[COUNTER_COUNT];
+	/* Value, time enabled and time running of each event when the current phase began */
+	uint64_t marks[COUNTER_COUNT][3];
+	/* Bit k is set when fds[k] is open */
+	unsigned int mask;
+} PerfCounters;
+
+/*  unsigned int openCounters(PerfCounters *counters, FILE *messages):
+ *
+ *  Input:
+ *      PerfCounters *counters: Receives the events, counting starts at once.
+ *      FILE *messages: Receives one warning when no event can be counted at all.
+ *
+ *  Output:
+ *      Events are counted in user space only, for the calling thread and the threads it creates
+ *      afterwards. Events the processor, the kernel or the container refuses are left out, and the
+ *      translation goes on without them.
+ *
+ *      unsigned int:
+ *          result: counters->mask, 0 when nothing can be counted.
+ */
+unsigned int openCounters(PerfCounters *counters, FILE *messages);
+
+/*  void lapCounters(PerfCounters *counters, Stats *stats, Phase phase):
+ *
+ *  Input:
+ *      PerfCounters *counters: Opened by openCounters().
+ *      Stats *stats: Receives the events since the previous lap (or since openCounters()) as phase,
+ *                    and counters->mask as counterMask.
+ *      Phase phase: The phase that just ended.
+ *
+ *  Output:
+ *      Events are scaled by the share of time they were really counted, when the processor has
+ *      fewer counters than events and the kernel takes turns.
+ */
+void lapCounters(PerfCounters *counters, Stats *stats, Phase phase);
+
+/*  void closeCounters(PerfCounters *counters):
+ *
+ *  Input:
+ *      PerfCounters *counters: Opened by openCounters(), or with mask 0.
+ */
+void closeCounters(PerfCounters *counters);
+
+/*  int writeCounters(FILE *out, const Stats *stats, const char *input):
+ *
+ *  Input:
+ *      FILE *out: Valid writable filestream.
+ *      const Stats *stats: Events of every phase and the number of instructions.
+ *      const char *input: Name of the input file.
+ *
+ *  Output:
+ *      Writes a table of events per translated instruction, one line per phase and one for the
+ *      total, "-" for events that could not be counted. The table is written at once, like
+ *      writeStats().
+ *
+ *      int:
+ *          0: When the table is written.
+ *          1: When memory runs out or the write fails.
+ */
+int writeCounters(FILE *out, const Stats *stats, const char *input);
+
+#endif
@@ -0,0 +1,184 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "compression.h"
+#include "pipeline.h"
+#include "ring.h"
+#include "utils.h"
+
+/* Slots of each ring, and the most words moved through a ring at once */
+#define RING_SIZE (1 << 16)
+#define BATCH_SIZE 4096
+/* Fewest instructions relocated and written at once, so that short windows do not cost a pass each */
+#define MIN_WINDOW (1 << 14)
+
+/* The reader thread, words go into ring in batches */
+typedef struct Reader {
+	FILE *in;
+	int binary;
+	Ring *ring;
+	uint32_t batch[BATCH_SIZE];
+	size_t used;
+} Reader;
+
+/* The writer thread, every word that comes out of ring is one finished instruction */
+typedef struct Writer {
+	FILE *out;
+	int binary;
+	Ring *ring;
+	int err;
+} Writer;
+
+static int readerSink(void *context, unsigned long word) {
+	Reader *reader = context;
+	/* 1. Collect a batch */
+	reader->batch[reader->used++] = (uint32_t) word;
+	if (reader->used < BATCH_SIZE) return 0;
+	/* 2. Hand it over, stop reading when nobody wants it anymore */
+	reader->used = 0;
+	return ringPush(reader->ring, reader->batch, BATCH_SIZE);
+}
+
+static void *runReader(void *argument) {
+	Reader *reader = argument;
+	reader->used = 0;
+	if (reader->binary) streamFromBinary(reader->in, readerSink, reader);
+	else streamFromFile(reader->in, readerSink, reader);
+	/* The last batch is partial */
+	ringPush(reader->ring, reader->batch, reader->used);
+	ringClose(reader->ring);
+	return NULL;
+}
+
+static void *runWriter(void *argument) {
+	Writer *writer = argument;
+	OutputBuffer buffer;
+	uint32_t batch[BATCH_SIZE];
+	size_t count, i;
+	writer->err = openOutput(&buffer, writer->out);
+	if (writer->err != 0) {
+		ringAbandon(writer->ring);
+		return NULL;
+	}
+	while ((count = ringPop(writer->ring, batch, BATCH_SIZE)) != 0) {
+		for (i = 0; i < count; ++i) {
+			/* The lowest two bits of a 32-bit instruction are always 11, those of a compressed one never are */
+			int length = (batch[i] & 0x3) == 0x3 ? 32 : 16;
+			if (writer->binary) writeParcels(&buffer, batch[i], length);
+			else writeline(&buffer, batch[i], length);
+		}
+	}
+	writer->err = closeOutput(&buffer);
+	return NULL;
+}
+
+static int emitWindow(Ring *ring, const Program *program, size_t begin, size_t end) {
+	uint32_t batch[BATCH_SIZE];
+	size_t used = 0, i;
+	for (i = begin; i < end; ++i) {
+		batch[used++] = program->types[i] == NON ? program->words[i] : program->encoded[i];
+		if (used == BATCH_SIZE) {
+			if (ringPush(ring, batch, used)) return 1;
+			used = 0;
+		}
+	}
+	return ringPush(ring, batch, used);
+}
+
+static int compressStream(Ring *input, Ring *output, unsigned int isa) {
+	uint32_t batch[BATCH_SIZE];
+	uint32_t *map = NULL;
+	size_t count, i, cut, base = 0, reach = 0, mapSize = 0;
+	int err = 0;
+	Program *program = newProgram(0);
+	if (program == NULL) return 2;
+	/* Windows are compressed one instruction at a time, Zcmp runs are left to the whole-program path */
+	program->isa = isa & ISA_ZCMP ? isa & ~(unsigned int) (ISA_ZCMP | ISA_D) : isa;
+	while (!err && (count = ringPop(input, batch, BATCH_SIZE)) != 0) {
+		size_t start = program->count;
+		/* 1. Append and compress the batch */
+		for (i = 0; i < count && !err; ++i) err = appendWord(program, batch[i]) ? 2 : 0;
+		if (err) break;
+		if (compressInstructions(program, start, program->count) != program->count) {
+			err = 3;
+			break;
+		}
+		/* 2. The map has a slot for every instruction of the program, and one for its end */
+		if (mapSize < program->capacity + 1) {
+			uint32_t *grown = realloc(map, sizeof(uint32_t) * (program->capacity + 1));
+			if (grown == NULL) {
+				err = 2;
+				break;
+			}
+			if (map == NULL) grown[0] = 0;
+			map = grown;
+			mapSize = program->capacity + 1;
+		}
+		/* 3. Everything before a point no forward branch jumps past is final */
+		cut = windowCut(program, start, program->count, &reach);
+		if (cut != 0 && cut - base >= MIN_WINDOW) {
+			finalizeWindow(program, map, base, cut);
+			err = emitWindow(output, program, base, cut) ? 2 : 0;
+			base = cut;
+		}
+	}
+	/* 4. The rest, branches past the end keep 4 bytes per instruction beyond it */
+	if (!err && map != NULL) {
+		finalizeWindow(program, map, base, program->count);
+		err = emitWindow(output, program, base, program->count) ? 2 : 0;
+	}
+	free(map);
+	clearAll(program);
+	return err;
+}
+
+int translateStream(FILE *in, int binaryInput, FILE *out, int binaryOutput, unsigned int isa) {
+	Ring input, output;
+	Reader *reader;
+	Writer writer;
+	pthread_t readerThread, writerThread;
+	int err;
+	/* 1. Check validation */
+	if (in == NULL || out == NULL) return 1;
+	/* 2. Two rings, the reader state holds a batch so it lives on the heap */
+	reader = malloc(sizeof(Reader));
+	if (reader == NULL) return 2;
+	if (ringInit(&input, RING_SIZE)) {
+		free(reader);
+		return 2;
+	}
+	if (ringInit(&output, RING_SIZE)) {
+		ringFree(&input);
+		free(reader);
+		return 2;
+	}
+	reader->in = in;
+	reader->binary = binaryInput;
+	reader->ring = &input;
+	writer.out = out;
+	writer.binary = binaryOutput;
+	writer.ring = &output;
+	writer.err = 0;
+	/* 3. Start the writer, then the reader */
+	err = pthread_create(&writerThread, NULL, runWriter, &writer) != 0 ? 2 : 0;
+	if (!err && pthread_create(&readerThread, NULL, runReader, reader) != 0) {
+		ringClose(&output);
+		pthread_join(writerThread, NULL);
+		err = 2;
+	} else if (!err) {
+		/* 4. This thread compresses in between */
+		err = compressStream(&input, &output, isa);
+		/* 5. The reader stops pushing once the ring is abandoned, the writer once it is closed */
+		ringAbandon(&input);
+		ringClose(&output);
+		pthread_join(readerThread, NULL);
+		pthread_join(writerThread, NULL);
+		if (!err) err = writer.err;
+	}
+	ringFree(&input);
+	ringFree(&output);
+	free(reader);
+	return err;
+}
@@ -0,0 +1,31 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+
+/*  int translateStream(FILE *in, int binaryInput, FILE *out, int binaryOutput, unsigned int isa):
+ *
+ *  Input:
+ *      FILE *in: Valid readable filestream, text (readFromFile()) or a flat word stream (readFromBinary()).
+ *      FILE *out: Valid writable filestream, receives text (writeToFile()) or bytes (writeToBinary()).
+ *      unsigned int isa: Instruction set the code is compressed for, ISA_* flags. ISA_ZCMP is left out (and with it
+ *                        ISA_D stays out), its runs need the whole program.
+ *
+ *  Output:
+ *      Same output as reading, compressing, relocating and writing one after another, but the three run
+ *      at the same time: a reader thread feeds words to the calling thread through a ring, which compresses
+ *      them and hands finished instructions to a writer thread through another ring. Instructions are held
+ *      back only while a forward branch before them still waits for its target, every window without such
+ *      a branch is relocated and written while the rest is still being read. This bounds latency, not memory:
+ *      the whole Program and its address map stay allocated until the end, since a backward branch may still
+ *      target any earlier instruction.
+ *
+ *      int:
+ *          0: In most usual cases.
+ *          1: When some input values are invalid.
+ *          2: When memory or threads cannot be allocated, or the output cannot be written.
+ *          3: When an instruction has an unknown opcode, the output stops before its window.
+ */
+int translateStream(FILE *in, int binaryInput, FILE *out, int binaryOutput, unsigned int isa);
+
+#endif
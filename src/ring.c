@@ -0,0 +1,122 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include "ring.h"
+
+/* Indices and flags shared between the two threads, through the atomic builtins of GCC and Clang */
+#define LOAD_ACQUIRE(pointer) __atomic_load_n(pointer, __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(pointer, value) __atomic_store_n(pointer, value, __ATOMIC_RELEASE)
+
+int ringInit(Ring *ring, size_t capacity) {
+	size_t size = 1;
+	/* 1. Round up, so that the slot of an index is index & mask */
+	while (size < capacity) size <<= 1;
+	ring->slots = malloc(sizeof(uint32_t) * size);
+	if (ring->slots == NULL) return 1;
+	/* 2. What the sides sleep on once spinning is not worth it anymore */
+	if (pthread_mutex_init(&ring->lock, NULL) != 0) {
+		free(ring->slots);
+		return 1;
+	}
+	if (pthread_cond_init(&ring->changed, NULL) != 0) {
+		pthread_mutex_destroy(&ring->lock);
+		free(ring->slots);
+		return 1;
+	}
+	ring->mask = size - 1;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->closed = 0;
+	ring->abandoned = 0;
+	ring->sleepers = 0;
+	return 0;
+}
+
+void ringFree(Ring *ring) {
+	free(ring->slots);
+	ring->slots = NULL;
+	pthread_cond_destroy(&ring->changed);
+	pthread_mutex_destroy(&ring->lock);
+}
+
+/* Sleep while the index of the other side is still seen and flag is not set. sleepers is raised before the
+ * last look at both, and the other side looks at sleepers after publishing, so one of them sees the other */
+static void ringSleep(Ring *ring, const size_t *index, size_t seen, const int *flag) {
+	pthread_mutex_lock(&ring->lock);
+	__atomic_add_fetch(&ring->sleepers, 1, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(index, __ATOMIC_SEQ_CST) == seen && !__atomic_load_n(flag, __ATOMIC_SEQ_CST)) pthread_cond_wait(&ring->changed, &ring->lock);
+	__atomic_sub_fetch(&ring->sleepers, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&ring->lock);
+}
+
+/* After publishing an index or a flag, wake the other side if it sleeps */
+static void ringWake(Ring *ring) {
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&ring->sleepers, __ATOMIC_RELAXED) == 0) return;
+	pthread_mutex_lock(&ring->lock);
+	pthread_cond_broadcast(&ring->changed);
+	pthread_mutex_unlock(&ring->lock);
+}
+
+int ringPush(Ring *ring, const uint32_t *values, size_t count) {
+	size_t tail = ring->tail;
+	int spins = 0;
+	while (count != 0) {
+		size_t room, i;
+		/* 1. Free slots, the consumer may only make more of them meanwhile */
+		room = ring->mask + 1 - (tail - LOAD_ACQUIRE(&ring->head));
+		if (room == 0) {
+			if (LOAD_ACQUIRE(&ring->abandoned)) return 1;
+			if (++spins < RING_SPINS) sched_yield();
+			else ringSleep(ring, &ring->head, tail - ring->mask - 1, &ring->abandoned);
+			continue;
+		}
+		spins = 0;
+		if (room > count) room = count;
+		/* 2. Fill the slots, then publish them */
+		for (i = 0; i < room; ++i) ring->slots[(tail + i) & ring->mask] = values[i];
+		tail += room;
+		STORE_RELEASE(&ring->tail, tail);
+		ringWake(ring);
+		values += room;
+		count -= room;
+	}
+	return LOAD_ACQUIRE(&ring->abandoned) ? 1 : 0;
+}
+
+size_t ringPop(Ring *ring, uint32_t *values, size_t max) {
+	size_t head = ring->head, available, i;
+	int spins = 0;
+	for (;;) {
+		/* 1. Values published by the producer */
+		available = LOAD_ACQUIRE(&ring->tail) - head;
+		if (available != 0) break;
+		/* 2. Closing comes after the last push, so the tail has to be checked once more */
+		if (LOAD_ACQUIRE(&ring->closed)) {
+			available = LOAD_ACQUIRE(&ring->tail) - head;
+			if (available == 0) return 0;
+			break;
+		}
+		if (++spins < RING_SPINS) sched_yield();
+		else ringSleep(ring, &ring->tail, head, &ring->closed);
+	}
+	if (available > max) available = max;
+	/* 3. Copy the values, then hand the slots back */
+	for (i = 0; i < available; ++i) values[i] = ring->slots[(head + i) & ring->mask];
+	STORE_RELEASE(&ring->head, head + available);
+	ringWake(ring);
+	return available;
+}
+
+void ringClose(Ring *ring) {
+	STORE_RELEASE(&ring->closed, 1);
+	ringWake(ring);
+}
+
+void ringAbandon(Ring *ring) {
+	STORE_RELEASE(&ring->abandoned, 1);
+	ringWake(ring);
+}
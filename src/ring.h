@@ -0,0 +1,78 @@
+#ifndef RING_H
+#define RING_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Rounds of sched_yield() a side spends on a full or empty ring before it sleeps until the other side moves */
+#define RING_SPINS 64
+
+/* Bounded single-producer / single-consumer queue of 32-bit words, without locks while both sides keep up.
+ * Only the producer writes tail, only the consumer writes head, each index is published with release
+ * ordering and read with acquire ordering, so the slots between them are always owned by one side.
+ * A side that waits longer than RING_SPINS rounds sleeps on changed, the other side only takes lock
+ * when sleepers says someone sleeps. */
+typedef struct Ring {
+	uint32_t *slots;
+	/* Capacity - 1, the capacity is a power of 2 */
+	size_t mask;
+	/* Next slot to read, written by the consumer */
+	size_t head;
+	/* head and tail on different cache lines, so that the two sides do not keep stealing one line */
+	char padding[64];
+	/* Next slot to write, written by the producer */
+	size_t tail;
+	/* Set by the producer after its last push */
+	int closed;
+	/* Set by the consumer when it stops reading, later pushes fail */
+	int abandoned;
+	/* Number of sides asleep on changed, 0 ~ 2 */
+	int sleepers;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+} Ring;
+
+/*  int ringInit(Ring *ring, size_t capacity):
+ *
+ *  Input:
+ *      Ring *ring: Receives an empty ring, release it with ringFree().
+ *      size_t capacity: Number of slots, rounded up to a power of 2.
+ *
+ *  Output:
+ *      int:
+ *          0: In most usual cases.
+ *          1: When the slots, the lock or the condition variable cannot be allocated.
+ */
+int ringInit(Ring *ring, size_t capacity);
+
+void ringFree(Ring *ring);
+
+/*  int ringPush(Ring *ring, const uint32_t *values, size_t count):
+ *
+ *  Producer only. Appends all values, yielding the processor while the ring is full, then sleeping.
+ *
+ *  Output:
+ *      int:
+ *          0: When every value has been pushed.
+ *          1: When the consumer has abandoned the ring.
+ */
+int ringPush(Ring *ring, const uint32_t *values, size_t count);
+
+/*  size_t ringPop(Ring *ring, uint32_t *values, size_t max):
+ *
+ *  Consumer only. Waits until the ring holds something or is closed, then takes up to max values.
+ *
+ *  Output:
+ *      size_t:
+ *          result: Number of values taken, 0 only once the ring is closed and empty.
+ */
+size_t ringPop(Ring *ring, uint32_t *values, size_t max);
+
+/* Producer only, after the last push */
+void ringClose(Ring *ring);
+
+/* Consumer only, when it will not read anymore */
+void ringAbandon(Ring *ring);
+
+#endif
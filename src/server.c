@@ -0,0 +1,350 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "compression.h"
+#include "parallel.h"
+#include "server.h"
+
+/* Accepted connections waiting for a worker */
+#define QUEUE_SIZE 64
+
+typedef struct Server {
+	TranslateJob *job;
+	int listener;
+	/* Connections from queue[head] on, count of them */
+	int queue[QUEUE_SIZE];
+	size_t head;
+	size_t count;
+	int stopping;
+	pthread_mutex_t lock;
+	/* Signalled when a connection is queued or the server stops, and when one is taken */
+	pthread_cond_t filled;
+	pthread_cond_t drained;
+} Server;
+
+/* Control data of a message, aligned for its header */
+typedef union FileControl {
+	struct cmsghdr header;
+	char data[CMSG_SPACE(sizeof(int) * JOB_FILES)];
+} FileControl;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void onSignal(int number) {
+	(void) number;
+	interrupted = 1;
+}
+
+static int fillAddress(struct sockaddr_un *address, const char *path) {
+	if (path == NULL || strlen(path) >= sizeof(address->sun_path)) return 1;
+	memset(address, 0, sizeof(*address));
+	address->sun_family = AF_UNIX;
+	strcpy(address->sun_path, path);
+	return 0;
+}
+
+static int sendMessage(int socket, const void *data, size_t size, const int *files, int fileCount) {
+	struct msghdr message;
+	struct iovec part;
+	FileControl control;
+	/* 1. The data in one part */
+	memset(&message, 0, sizeof(message));
+	part.iov_base = (void *) data;
+	part.iov_len = size;
+	message.msg_iov = &part;
+	message.msg_iovlen = 1;
+	/* 2. The files as SCM_RIGHTS, the receiver gets its own descriptors for them */
+	if (fileCount > 0) {
+		struct cmsghdr *header;
+		memset(&control, 0, sizeof(control));
+		message.msg_control = control.data;
+		message.msg_controllen = CMSG_SPACE(sizeof(int) * fileCount);
+		header = CMSG_FIRSTHDR(&message);
+		header->cmsg_level = SOL_SOCKET;
+		header->cmsg_type = SCM_RIGHTS;
+		header->cmsg_len = CMSG_LEN(sizeof(int) * fileCount);
+		memcpy(CMSG_DATA(header), files, sizeof(int) * fileCount);
+	}
+	return sendmsg(socket, &message, MSG_NOSIGNAL) != (ssize_t) size;
+}
+
+static long receiveMessage(int socket, void *data, size_t size, int *files, int *fileCount) {
+	struct msghdr message;
+	struct iovec part;
+	struct cmsghdr *header;
+	FileControl control;
+	long received;
+	/* 1. One message, SOCK_SEQPACKET keeps it whole */
+	memset(&message, 0, sizeof(message));
+	part.iov_base = data;
+	part.iov_len = size;
+	message.msg_iov = &part;
+	message.msg_iovlen = 1;
+	message.msg_control = control.data;
+	message.msg_controllen = sizeof(control.data);
+	*fileCount = 0;
+	do received = recvmsg(socket, &message, 0);
+	while (received < 0 && errno == EINTR);
+	if (received < 0) return received;
+	/* 2. Take every file that came along, even from a message that is then rejected, so none leaks */
+	for (header = CMSG_FIRSTHDR(&message); header != NULL; header = CMSG_NXTHDR(&message, header)) {
+		int count, i;
+		if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) continue;
+		count = (int) ((header->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+		for (i = 0; i < count; ++i) {
+			int file;
+			memcpy(&file, CMSG_DATA(header) + sizeof(int) * i, sizeof(int));
+			if (*fileCount < JOB_FILES) files[(*fileCount)++] = file;
+			else close(file);
+		}
+	}
+	return (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) ? -1 : received;
+}
+
+static int pushConnection(Server *server, int connection) {
+	int err = 0;
+	pthread_mutex_lock(&server->lock);
+	while (server->count == QUEUE_SIZE && !server->stopping) pthread_cond_wait(&server->drained, &server->lock);
+	if (server->stopping) {
+		err = 1;
+	} else {
+		server->queue[(server->head + server->count++) % QUEUE_SIZE] = connection;
+		pthread_cond_signal(&server->filled);
+	}
+	pthread_mutex_unlock(&server->lock);
+	return err;
+}
+
+static int takeConnection(Server *server) {
+	int connection = -1;
+	pthread_mutex_lock(&server->lock);
+	/* Queued connections are still served after a stop */
+	while (server->count == 0 && !server->stopping) pthread_cond_wait(&server->filled, &server->lock);
+	if (server->count != 0) {
+		connection = server->queue[server->head];
+		server->head = (server->head + 1) % QUEUE_SIZE;
+		--server->count;
+		pthread_cond_signal(&server->drained);
+	}
+	pthread_mutex_unlock(&server->lock);
+	return connection;
+}
+
+static void stopServer(Server *server) {
+	pthread_mutex_lock(&server->lock);
+	server->stopping = 1;
+	pthread_cond_broadcast(&server->filled);
+	pthread_cond_broadcast(&server->drained);
+	pthread_mutex_unlock(&server->lock);
+	/* Wakes up accept() */
+	shutdown(server->listener, SHUT_RDWR);
+}
+
+static int runTranslate(Server *server, JobRequest *request, const int *files, int fileCount) {
+	char *arguments[JOB_ARGUMENTS / 2];
+	FILE *streams[JOB_FILES];
+	size_t offset = 0;
+	int argc = 0, status = -1, i;
+	/* 1. Split the options, none may run past the buffer */
+	request->arguments[JOB_ARGUMENTS - 1] = '\0';
+	request->name[JOB_NAME - 1] = '\0';
+	while ((uint32_t) argc < request->argumentCount && offset < JOB_ARGUMENTS - 1) {
+		arguments[argc++] = request->arguments + offset;
+		offset += strlen(request->arguments + offset) + 1;
+	}
+	if ((uint32_t) argc != request->argumentCount || fileCount != JOB_FILES) {
+		for (i = 0; i < fileCount; ++i) close(files[i]);
+		return -1;
+	}
+	arguments[argc] = NULL;
+	/* 2. The files of the client, used like the ones the command line opens */
+	streams[0] = fdopen(files[0], "rb");
+	streams[1] = fdopen(files[1], "w");
+	streams[2] = fdopen(files[2], "w");
+	if (streams[0] != NULL && streams[1] != NULL && streams[2] != NULL) {
+		status = server->job(argc, arguments, request->name, streams[0], streams[1], streams[2]);
+	}
+	for (i = 0; i < JOB_FILES; ++i) {
+		if (streams[i] != NULL) fclose(streams[i]);
+		else close(files[i]);
+	}
+	return status;
+}
+
+static int runCompact(const JobRequest *request, const int *files, int fileCount, JobReply *reply) {
+	struct stat info;
+	CompactResult result;
+	size_t count = (size_t) request->count, size;
+	uint32_t *words;
+	int status = -1;
+	/* 1. Exactly one file, large enough for the words and the map */
+	if (fileCount != 1) {
+		while (fileCount > 0) close(files[--fileCount]);
+		return -1;
+	}
+	if ((uint64_t) count != request->count || count > ((size_t) -1) / 8 - 1) {
+		close(files[0]);
+		return -1;
+	}
+	size = sizeof(uint32_t) * (request->withMap ? 2 * count + 1 : count);
+	if (fstat(files[0], &info) != 0 || (uint64_t) info.st_size < (uint64_t) size) {
+		close(files[0]);
+		return -1;
+	}
+	/* 2. Compact right in the pages of the client */
+	words = size == 0 ? NULL : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, files[0], 0);
+	if (words != MAP_FAILED) {
+		status = compactWords(words, count, request->withMap ? words + count : NULL, &result);
+		reply->length = result.length;
+		reply->compressed = result.compressed;
+		reply->branches = result.branches;
+		reply->invalid = result.invalid;
+		if (words != NULL) munmap(words, size);
+	}
+	close(files[0]);
+	return status;
+}
+
+static void serveConnection(Server *server, int connection) {
+	JobRequest *request = malloc(sizeof(JobRequest));
+	JobReply reply;
+	int files[JOB_FILES], fileCount;
+	long received;
+	if (request == NULL) return;
+	/* 1. One request after the other until the client hangs up */
+	while ((received = receiveMessage(connection, request, sizeof(JobRequest), files, &fileCount)) != 0) {
+		memset(&reply, 0, sizeof(reply));
+		reply.magic = JOB_MAGIC;
+		reply.status = -1;
+		if (received != (long) sizeof(JobRequest) || request->magic != JOB_MAGIC) {
+			while (fileCount > 0) close(files[--fileCount]);
+			if (received < 0) break;
+		} else if (request->kind == JOB_TRANSLATE) {
+			reply.status = runTranslate(server, request, files, fileCount);
+		} else if (request->kind == JOB_COMPACT) {
+			reply.status = runCompact(request, files, fileCount, &reply);
+		} else {
+			while (fileCount > 0) close(files[--fileCount]);
+			if (request->kind == JOB_STOP) {
+				reply.status = 0;
+				stopServer(server);
+			}
+		}
+		/* 2. The answer, a client that went away only ends the connection */
+		if (sendMessage(connection, &reply, sizeof(reply), NULL, 0)) break;
+	}
+	free(request);
+}
+
+static void *runWorker(void *argument) {
+	Server *server = argument;
+	int connection;
+	while ((connection = takeConnection(server)) >= 0) {
+		serveConnection(server, connection);
+		close(connection);
+	}
+	return NULL;
+}
+
+/* Whether a server still answers on address, so that its socket is not taken over */
+static int isListening(const struct sockaddr_un *address) {
+	int probe = socket(AF_UNIX, SOCK_SEQPACKET, 0), listening;
+	if (probe < 0) return 0;
+	listening = connect(probe, (const struct sockaddr *) address, sizeof(*address)) == 0;
+	close(probe);
+	return listening;
+}
+
+int serve(const char *path, int workers, TranslateJob *job) {
+	Server server;
+	struct sockaddr_un address;
+	struct sigaction action;
+	struct stat info;
+	pthread_t threads[MAX_THREADS];
+	int started = 0, err = 0, i;
+	/* 1. Check validation */
+	if (fillAddress(&address, path) || workers < 1 || workers > MAX_THREADS || job == NULL) return 1;
+	if (isListening(&address)) return 1;
+	if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode)) unlink(path);
+	/* 2. The socket, one message per request */
+	server.listener = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (server.listener < 0) return 2;
+	if (bind(server.listener, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(server.listener, SOMAXCONN) != 0) {
+		close(server.listener);
+		return 2;
+	}
+	server.job = job;
+	server.head = 0;
+	server.count = 0;
+	server.stopping = 0;
+	pthread_mutex_init(&server.lock, NULL);
+	pthread_cond_init(&server.filled, NULL);
+	pthread_cond_init(&server.drained, NULL);
+	/* 3. Signals interrupt accept() instead of restarting it, a client that hangs up is no signal at all */
+	memset(&action, 0, sizeof(action));
+	sigemptyset(&action.sa_mask);
+	action.sa_handler = onSignal;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	action.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &action, NULL);
+	/* 4. The workers live as long as the server */
+	while (started < workers && pthread_create(&threads[started], NULL, runWorker, &server) == 0) ++started;
+	if (started == 0) err = 2;
+	/* 5. This thread only accepts */
+	while (!err && !interrupted) {
+		int connection = accept(server.listener, NULL, NULL);
+		if (connection < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			break;
+		}
+		if (pushConnection(&server, connection)) {
+			close(connection);
+			break;
+		}
+	}
+	/* 6. Finish what has been accepted */
+	stopServer(&server);
+	for (i = 0; i < started; ++i) pthread_join(threads[i], NULL);
+	close(server.listener);
+	unlink(path);
+	pthread_mutex_destroy(&server.lock);
+	pthread_cond_destroy(&server.filled);
+	pthread_cond_destroy(&server.drained);
+	return err;
+}
+
+int submitJob(const char *path, const JobRequest *request, const int *files, int fileCount, JobReply *reply) {
+	struct sockaddr_un address;
+	JobRequest *message;
+	int connection, received, err = 1;
+	/* 1. Check validation */
+	if (fillAddress(&address, path) || request == NULL || reply == NULL || fileCount < 0 || fileCount > JOB_FILES) return 1;
+	message = malloc(sizeof(JobRequest));
+	if (message == NULL) return 1;
+	memcpy(message, request, sizeof(JobRequest));
+	message->magic = JOB_MAGIC;
+	/* 2. One connection per job */
+	connection = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (connection >= 0 && connect(connection, (struct sockaddr *) &address, sizeof(address)) == 0 &&
+	    sendMessage(connection, message, sizeof(JobRequest), files, fileCount) == 0) {
+		int extra[JOB_FILES];
+		/* 3. The server sends no files back */
+		received = (int) receiveMessage(connection, reply, sizeof(JobReply), extra, &fileCount);
+		while (fileCount > 0) close(extra[--fileCount]);
+		err = received != (int) sizeof(JobReply) || reply->magic != JOB_MAGIC;
+	}
+	if (connection >= 0) close(connection);
+	free(message);
+	return err;
+}
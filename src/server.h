@@ -0,0 +1,93 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* First field of every request and reply, anything else on the socket is rejected */
+#define JOB_MAGIC 0x52564331
+/* Room for the options of a request, each one ends with '\0' */
+#define JOB_ARGUMENTS 1024
+/* Room for the name of the input file of a request */
+#define JOB_NAME 4096
+/* Most open files that come along with a request */
+#define JOB_FILES 3
+
+/* What a request asks the server for */
+typedef enum JobKind {
+	/* Translate like the command line, the input, output and message files come along with the request */
+	JOB_TRANSLATE = 1,
+	/* Compact the words of a shared memory file in place (compactWords()), the file comes along with the request */
+	JOB_COMPACT,
+	/* Stop the server, the jobs already accepted still run */
+	JOB_STOP
+} JobKind;
+
+/* One request, sent as a single message with its files attached */
+typedef struct JobRequest {
+	uint32_t magic;
+	/* One of JobKind */
+	uint32_t kind;
+	/* JOB_TRANSLATE: number of options in arguments */
+	uint32_t argumentCount;
+	/* JOB_COMPACT: whether room for an offset map of count + 1 entries follows the words */
+	uint32_t withMap;
+	/* JOB_COMPACT: number of words at the start of the file */
+	uint64_t count;
+	/* JOB_TRANSLATE: the options of the command line, without the file names */
+	char arguments[JOB_ARGUMENTS];
+	/* JOB_TRANSLATE: name of the input file, only to tell its format */
+	char name[JOB_NAME];
+} JobRequest;
+
+/* The answer to one request */
+typedef struct JobReply {
+	uint32_t magic;
+	/* What the job returned, -1 when the request itself is malformed */
+	int32_t status;
+	/* JOB_COMPACT: the CompactResult */
+	uint64_t length;
+	uint64_t compressed;
+	uint64_t branches;
+	uint64_t invalid;
+} JobReply;
+
+/* Runs a JOB_TRANSLATE request on files that are already open, returns the status of the reply */
+typedef int TranslateJob(int argc, char **argv, const char *name, FILE *in, FILE *out, FILE *messages);
+
+/*  int serve(const char *path, int workers, TranslateJob *job):
+ *
+ *  Input:
+ *      const char *path: Where the Unix domain socket is created, a socket left behind by a dead server is replaced.
+ *      int workers: Number of threads that run jobs, 1 to MAX_THREADS.
+ *      TranslateJob *job: Runs JOB_TRANSLATE requests.
+ *
+ *  Output:
+ *      Accepts connections until a JOB_STOP request, SIGINT or SIGTERM, and hands them to a pool of workers.
+ *      A connection may send any number of requests. Files are never opened by the server: the client opens
+ *      them and sends the descriptors, so the input is read and the output written where the client put it,
+ *      and words are compacted inside the client's shared memory without being copied.
+ *
+ *      int:
+ *          0: When the server has been stopped.
+ *          1: When some input values are invalid, or another server listens on path.
+ *          2: When the socket or threads cannot be created.
+ */
+int serve(const char *path, int workers, TranslateJob *job);
+
+/*  int submitJob(const char *path, const JobRequest *request, const int *files, int fileCount, JobReply *reply):
+ *
+ *  Input:
+ *      const char *path: Socket of a running server.
+ *      const JobRequest *request: The request, magic is filled in here.
+ *      const int *files, int fileCount: Descriptors sent along, at most JOB_FILES. They stay open here.
+ *      JobReply *reply: Receives the answer.
+ *
+ *  Output:
+ *      int:
+ *          0: When reply holds the answer of the server.
+ *          1: When the server cannot be reached or hangs up before answering.
+ */
+int submitJob(const char *path, const JobRequest *request, const int *files, int fileCount, JobReply *reply);
+
+#endif
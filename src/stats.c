@@ -0,0 +1,114 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "stats.h"
+
+/* Names in the JSON output, in the order of the enums */
+static const char *const phaseNames[PHASE_COUNT] = {"parse", "classify", "relocate", "write"};
+static const char *const counterNames[COUNTER_COUNT] = {"cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"};
+static const char *const insTypeNames[UJ + 1] = {"unknown", "I", "U", "S", "R", "SB", "UJ"};
+static const char *const ctypeNames[CTYPE_COUNT] = {"none",   "c.add",  "c.mv",   "c.jr",   "c.jalr", "c.li",   "c.lui",  "c.addi",
+                                                    "c.slli", "c.lw",   "c.sw",   "c.and",  "c.or",   "c.xor",  "c.sub",  "c.beqz",
+                                                    "c.bnez", "c.srli", "c.srai", "c.andi", "c.j",    "c.jal",  "c.lwsp", "c.swsp",
+                                                    "c.addi16sp", "c.addi4spn", "c.ld", "c.sd", "c.ldsp", "c.sdsp", "c.addiw", "c.addw", "c.subw",
+                                                    "c.flw",  "c.fsw",  "c.flwsp", "c.fswsp", "c.fld", "c.fsd", "c.fldsp", "c.fsdsp",
+                                                    "c.lbu",  "c.lhu",  "c.lh",   "c.sb",   "c.sh",   "c.zext.b", "c.sext.b", "c.zext.h",
+                                                    "c.sext.h", "c.zext.w", "c.not", "c.mul", "cm.push", "cm.pop", "cm.popret", "cm.mvsa01", "folded"};
+
+double lapSeconds(double *mark) {
+	struct timespec now;
+	double seconds, elapsed;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	seconds = (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+	elapsed = *mark > 0 ? seconds - *mark : 0;
+	*mark = seconds;
+	return elapsed;
+}
+
+void countProgram(Stats *stats, const Program *program) {
+	size_t i;
+	/* 1. One pass over the instructions, only ever made when stats are asked for */
+	memset(stats->insTypes, 0, sizeof(stats->insTypes));
+	memset(stats->ctypes, 0, sizeof(stats->ctypes));
+	stats->branches = 0;
+	for (i = 0; i < program->count; ++i) {
+		InsType type = getType(program->words[i]);
+		++stats->insTypes[type];
+		++stats->ctypes[program->types[i] < CTYPE_COUNT ? program->types[i] : NON];
+		stats->branches += type == SB || type == UJ;
+	}
+	/* 2. Every compressed instruction saves 2 bytes, and every one folded into it 4 */
+	stats->instructions = program->count;
+	stats->bytesIn = 4 * program->count;
+	stats->bytesOut = 4 * stats->ctypes[NON] + 2 * (program->count - stats->ctypes[NON] - stats->ctypes[FOLDED]);
+}
+
+/* Append text to a JSON string, quotes and control characters escaped */
+static char *appendEscaped(char *cursor, const char *text) {
+	for (; *text != '\0'; ++text) {
+		unsigned char c = (unsigned char) *text;
+		if (c == '"' || c == '\\') {
+			*cursor++ = '\\';
+			*cursor++ = (char) c;
+		} else if (c < 0x20) {
+			sprintf(cursor, "\\u%04x", c);
+			cursor += 6;
+		} else {
+			*cursor++ = (char) c;
+		}
+	}
+	return cursor;
+}
+
+int writeStats(FILE *out, const Stats *stats, const char *input) {
+	struct rusage usage;
+	char *line, *cursor;
+	double total = 0;
+	int i, err;
+	/* 1. Room for the escaped name and every number */
+	line = malloc(6 * strlen(input) + 64 * (PHASE_COUNT * (COUNTER_COUNT + 1) + UJ + 1 + CTYPE_COUNT) + 512);
+	if (line == NULL) return 1;
+	cursor = line + sprintf(line, "{\"input\":\"");
+	cursor = appendEscaped(cursor, input);
+	/* 2. Sizes */
+	cursor += sprintf(cursor, "\",\"instructions\":%lu,\"bytes_in\":%lu,\"bytes_out\":%lu,\"ratio\":%.4f,\"relocated_branches\":%lu", (unsigned long) stats->instructions,
+	                  (unsigned long) stats->bytesIn, (unsigned long) stats->bytesOut, stats->bytesIn ? (double) stats->bytesOut / (double) stats->bytesIn : 1.0,
+	                  (unsigned long) stats->branches);
+	/* 3. Timings */
+	cursor += sprintf(cursor, ",\"seconds\":{");
+	for (i = 0; i < PHASE_COUNT; ++i) {
+		cursor += sprintf(cursor, "\"%s\":%.6f,", phaseNames[i], stats->seconds[i]);
+		total += stats->seconds[i];
+	}
+	cursor += sprintf(cursor, "\"total\":%.6f}", total);
+	/* 4. Counts, unknown and none included */
+	cursor += sprintf(cursor, ",\"instypes\":{");
+	for (i = 0; i <= UJ; ++i) cursor += sprintf(cursor, "%s\"%s\":%lu", i ? "," : "", insTypeNames[i], (unsigned long) stats->insTypes[i]);
+	cursor += sprintf(cursor, "},\"ctypes\":{");
+	for (i = 0; i < CTYPE_COUNT; ++i) cursor += sprintf(cursor, "%s\"%s\":%lu", i ? "," : "", ctypeNames[i], (unsigned long) stats->ctypes[i]);
+	/* 5. Events of every phase, only those that could be counted */
+	cursor += sprintf(cursor, "}");
+	if (stats->counterMask != 0) {
+		cursor += sprintf(cursor, ",\"counters\":{");
+		for (i = 0; i < PHASE_COUNT; ++i) {
+			int k, first = 1;
+			cursor += sprintf(cursor, "%s\"%s\":{", i ? "," : "", phaseNames[i]);
+			for (k = 0; k < COUNTER_COUNT; ++k) {
+				if (!(stats->counterMask >> k & 1)) continue;
+				cursor += sprintf(cursor, "%s\"%s\":%.0f", first ? "" : ",", counterNames[k], (double) stats->counters[i][k]);
+				first = 0;
+			}
+			cursor += sprintf(cursor, "}");
+		}
+		cursor += sprintf(cursor, "}");
+	}
+	/* 6. Peak memory of the whole process, in KiB on Linux */
+	cursor += sprintf(cursor, ",\"peak_rss_kib\":%ld}\n", getrusage(RUSAGE_SELF, &usage) == 0 ? (long) usage.ru_maxrss : -1L);
+	err = fputs(line, out) == EOF || fflush(out) != 0;
+	free(line);
+	return err;
+}
@@ -0,0 +1,91 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "utils.h"
+
+/* Number of kinds of compressed instruction, the last Ctype plus one */
+#define CTYPE_COUNT (FOLDED + 1)
+
+/* Timed phases of a translation */
+typedef enum Phase {
+	/* Reading the input into a Program */
+	PHASE_PARSE = 0,
+	/* primaryCompression() */
+	PHASE_CLASSIFY,
+	/* relaxBranches() and confirmAddress() */
+	PHASE_RELOCATE,
+	/* Writing the output */
+	PHASE_WRITE,
+	PHASE_COUNT
+} Phase;
+
+/* Hardware events of --perf-counters */
+typedef enum Counter {
+	COUNTER_CYCLES = 0,
+	COUNTER_INSTRUCTIONS,
+	COUNTER_BRANCH_MISSES,
+	/* Read misses of the first level data cache, and of the last level cache */
+	COUNTER_L1D_MISSES,
+	COUNTER_LLC_MISSES,
+	COUNTER_COUNT
+} Counter;
+
+/* What --stats reports about one translation */
+typedef struct Stats {
+	/* Wall-clock seconds of each phase, from a monotonic clock */
+	double seconds[PHASE_COUNT];
+	/* Number of instructions, and of them per InsType and per Ctype (NON counts those left at 32 bits) */
+	size_t instructions;
+	size_t insTypes[UJ + 1];
+	size_t ctypes[CTYPE_COUNT];
+	/* Number of branches and jumps whose offset was relocated */
+	size_t branches;
+	/* Size of the code before and after, in bytes */
+	size_t bytesIn;
+	size_t bytesOut;
+	/* Events of each phase (--perf-counters), bit k of counterMask is set when Counter k could be counted */
+	uint64_t counters[PHASE_COUNT][COUNTER_COUNT];
+	unsigned int counterMask;
+} Stats;
+
+/*  double lapSeconds(double *mark):
+ *
+ *  Input:
+ *      double *mark: Time of the previous lap, 0 to start. Receives the current time.
+ *
+ *  Output:
+ *      double:
+ *          result: Seconds since mark on a monotonic clock, 0 for the first lap.
+ */
+double lapSeconds(double *mark);
+
+/*  void countProgram(Stats *stats, const Program *program):
+ *
+ *  Input:
+ *      Stats *stats: Receives the counts and sizes, the timings are left alone.
+ *      const Program *program: After primaryCompression() and relaxBranches().
+ */
+void countProgram(Stats *stats, const Program *program);
+
+/*  int writeStats(FILE *out, const Stats *stats, const char *input):
+ *
+ *  Input:
+ *      FILE *out: Valid writable filestream.
+ *      const Stats *stats: What to report.
+ *      const char *input: Name of the input file.
+ *
+ *  Output:
+ *      Writes one JSON object on one line, in a single write so that lines of translations running
+ *      at the same time never mix. It also holds the peak resident set size of the process so far,
+ *      and the hardware events of every phase that could be counted.
+ *
+ *      int:
+ *          0: When the line is written.
+ *          1: When memory runs out or the write fails.
+ */
+int writeStats(FILE *out, const Stats *stats, const char *input);
+
+#endif
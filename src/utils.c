@@ -1,9 +1,23 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "imm.h"
+#include "parallel.h"
 #include "utils.h"
 
+/* Eight ASCII '0' characters, and the multiplier that gathers the low bit of eight bytes into the top byte */
+#define ASCII_ZEROS UINT64_C(0x3030303030303030)
+#define ASCII_NOT_BITS UINT64_C(0xFEFEFEFEFEFEFEFE)
+#define GATHER_BITS UINT64_C(0x8040201008040201)
+
 static unsigned long stringToBinaryNumber(const char *instruction) {
 
 	/* 1.1 Check validation of input object */
@@ -19,8 +33,9 @@ static int readline(FILE *in, unsigned long *returnValue) {
 	if (in == NULL || returnValue == NULL) { return 1; }
 
 	/* 2.2 Read in a line of original file and check if we've met the end */
-	if (fscanf(in, "%s", temp) == EOF) { return 2; }
-
+	if (fscanf(in, "%32s", temp) != 1) { return 2; }
+	/* Characters beyond the 32nd belong to the same line and are dropped */
+	if (fscanf(in, "%*[^ \t\r\n\v\f]") == EOF) { clearerr(in); }
 
 	/* 2.3 Get rid of '\n' */
 	temp[32] = 0;
@@ -30,26 +45,133 @@ static int readline(FILE *in, unsigned long *returnValue) {
 	return 0;
 }
 
-static int writeline(FILE *out, unsigned long target, int length) {
-	/* 3.1 Check validation of input objects */
-	/* if (out == NULL) { return 1; } */
-	/* if (length != 16 && length != 32) { return 2; } */
-	/* The guards are not needed, I commented them out to avoid clang-tidy warnings */
+static int isBlank(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f'; }
+
+static int swarEightBits(const char *text, unsigned long *returnValue) {
+	uint64_t chunk;
+	/* 18.1 Load eight characters at once, the first character must end up in the lowest byte */
+	memcpy(&chunk, text, sizeof(chunk));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	chunk = __builtin_bswap64(chunk);
+#endif
+	/* 18.2 Every byte becomes 0 or 1, any other character leaves a bit set outside the lowest one */
+	chunk -= ASCII_ZEROS;
+	if (chunk & ASCII_NOT_BITS) return 1;
+	/* 18.3 One multiplication moves byte i to bit (7 - i) of the top byte */
+	*returnValue = (unsigned long) ((chunk * GATHER_BITS) >> 56);
+	return 0;
+}
 
-	/* 3.2 Write into the file */
+static int parseMappedLine(const char **cursor, const char *end, unsigned long *returnValue) {
+	const char *p = *cursor, *token;
+	/* 19.1 Skip blank characters, including the '\r' of CRLF files and trailing spaces or tabs */
+	while (p != end && isBlank(*p)) ++p;
+	if (p == end) { *cursor = p; return 2; }
+	token = p;
+	/* 19.2 Fast path: 32 valid digits followed by a blank or the end of file */
+	if (end - p >= 32 && (end - p == 32 || isBlank(p[32]))) {
+		unsigned long a, b, c, d;
+		if (!swarEightBits(p, &a) && !swarEightBits(p + 8, &b) && !swarEightBits(p + 16, &c) && !swarEightBits(p + 24, &d)) {
+			*returnValue = (a << 24) | (b << 16) | (c << 8) | d;
+			*cursor = p + 32;
+			return 0;
+		}
+	}
+	/* 19.3 Slow path, same as readline(): the first 32 characters are converted like strtoul() */
 	{
-		int i;
-		for (i = length - 1; i >= 0; --i) {
-			/* 3.3 0 has ASCII code 48 */
-			if (fputc((((1 << i) & target) != 0) + 48, out) == EOF) return 3;
+		unsigned long value = 0;
+		while (p != end && p - token < 32 && (*p == '0' || *p == '1')) value = (value << 1) | (unsigned long) (*p++ - '0');
+		*returnValue = value;
+	}
+	/* 19.4 Drop the rest of the line */
+	while (p != end && !isBlank(*p)) ++p;
+	*cursor = p;
+	return 0;
+}
+
+/* Text of every byte value, most significant bit first: BITS8("") expands into 256 string literals */
+#define BITS1(prefix) prefix "0", prefix "1"
+#define BITS2(prefix) BITS1(prefix "0"), BITS1(prefix "1")
+#define BITS3(prefix) BITS2(prefix "0"), BITS2(prefix "1")
+#define BITS4(prefix) BITS3(prefix "0"), BITS3(prefix "1")
+#define BITS5(prefix) BITS4(prefix "0"), BITS4(prefix "1")
+#define BITS6(prefix) BITS5(prefix "0"), BITS5(prefix "1")
+#define BITS7(prefix) BITS6(prefix "0"), BITS6(prefix "1")
+#define BITS8(prefix) BITS7(prefix "0"), BITS7(prefix "1")
+static const char byteText[256][9] = {BITS8("")};
+
+/* Size of the output buffer, flushed with a single write() each time it fills up */
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+static void flushOutput(OutputBuffer *out) {
+	size_t done = 0;
+	/* 3.1 Streams without a file descriptor (e.g. memory streams) get a single fwrite() */
+	if (out->fd < 0) {
+		if (fwrite(out->data, 1, out->used, out->stream) != out->used) out->failed = 1;
+		out->used = 0;
+		return;
+	}
+	/* 3.2 write() may be partial or interrupted, keep going until everything is out */
+	while (done < out->used) {
+		ssize_t written = write(out->fd, out->data + done, out->used - done);
+		if (written < 0 && errno == EINTR) continue;
+		if (written <= 0) {
+			out->failed = 1;
+			break;
 		}
+		done += (size_t) written;
 	}
+	out->used = 0;
+}
 
-	/* 3.4 Newline after successfully written */
-	if (fputc('\n', out) == EOF) { return 3; }
+int openOutput(OutputBuffer *out, FILE *stream) {
+	/* 3.6 Anything already buffered by stdio goes first, afterwards we write to the descriptor directly */
+	if (fflush(stream) != 0) return 2;
+	out->stream = stream;
+	out->fd = fileno(stream);
+	out->used = 0;
+	out->failed = 0;
+	out->data = malloc(OUTPUT_BUFFER_SIZE);
+	return out->data == NULL ? 2 : 0;
+}
 
-	/* 3.5 Return 0 when nothing unusual happens */
-	return 0;
+int closeOutput(OutputBuffer *out) {
+	/* 3.7 Write out what is left */
+	flushOutput(out);
+	free(out->data);
+	return out->failed ? 2 : 0;
+}
+
+void writeParcels(OutputBuffer *out, unsigned long target, int length) {
+	unsigned char *bytes;
+	/* 3.8 Little-endian, two bytes per 16 bits */
+	if (OUTPUT_BUFFER_SIZE - out->used < 4) flushOutput(out);
+	bytes = (unsigned char *) out->data + out->used;
+	bytes[0] = (unsigned char) (target & 0xFF);
+	bytes[1] = (unsigned char) ((target >> 8) & 0xFF);
+	if (length == 32) {
+		bytes[2] = (unsigned char) ((target >> 16) & 0xFF);
+		bytes[3] = (unsigned char) ((target >> 24) & 0xFF);
+	}
+	out->used += (size_t) length / 8;
+}
+
+void writeline(OutputBuffer *out, unsigned long target, int length) {
+	char *text;
+	/* 3.3 Make sure 32 digits and a newline fit */
+	if (OUTPUT_BUFFER_SIZE - out->used < 33) flushOutput(out);
+	text = out->data + out->used;
+	/* 3.4 Copy the text of each byte, most significant byte first */
+	if (length == 32) {
+		memcpy(text, byteText[(target >> 24) & 0xFF], 8);
+		memcpy(text + 8, byteText[(target >> 16) & 0xFF], 8);
+		text += 16;
+	}
+	memcpy(text, byteText[(target >> 8) & 0xFF], 8);
+	memcpy(text + 8, byteText[target & 0xFF], 8);
+	/* 3.5 Newline after the digits */
+	text[16] = '\n';
+	out->used += (size_t) length + 1;
 }
 
 static short getOpcode(unsigned long instruction) {
@@ -70,84 +192,7 @@ static short getFunct7(unsigned long instruction) {
 	/*func7 occupies 7 location*/
 }
 
-/*having examined this function all match*/
-static int isInCompressAbleList(unsigned long instruction) {
-	switch (getOpcode(instruction)) {
-			/* 7.1 I-type */
-		case 0x67:
-			/* 7.2 jalr */
-			return 1;
-		case 0x03:
-			if (getFunct3(instruction) == 0x2) {
-				/* 7.3 lw */
-				return 1;
-			}
-			break;
-		case 0x13:
-			/* When opcode equals to 19 */
-			switch (getFunct3(instruction)) {
-				case 0x0:
-					/* 7.4 addi */
-				case 0x1:
-					/* 7.5 slli */
-				case 0x5:
-					/* 7.6 srli srai */
-				case 0x7:
-					/* 7.7 andi */
-					return 1;
-				default:
-					return 0;
-			}
-			/* 7.8 U-type */
-		case 0x37:
-			/* 7.9 auipc */
-			return 1;
-			/* 7.10 S-type */
-		case 0x23:
-			if (getFunct3(instruction) == 0x2) {
-				/* 7.11 sw */
-				return 1;
-			}
-			break;
-			/* 7.12 R-type */
-		case 0x33:
-			switch (getFunct3(instruction)) {
-				case 0x0:
-					/* 7.13 add sub */
-				case 0x4:
-					/* 7.14 xor */
-				case 0x6:
-					/* 7.15 or */
-				case 0x7:
-					/* 7.16 and */
-					return 1;
-				default:
-					return 0;
-			}
-			/* 7.17 SB-type */
-		case 0x63:
-			switch (getFunct3(instruction)) {
-				case 0x0:
-					/* 7.18 beq */
-				case 0x1:
-					/* 7.19 bne */
-					return 1;
-				default:
-					return 0;
-			}
-			/* 7.20 UJ-type */
-		case 0x6F:
-			/* 7.21 jal */
-			return 1;
-			/* 7.22 Not possible */
-		default:
-			return 0;
-	}
-	/* 7.23 By default */
-	return 0;
-}
-
-static InsType getType(unsigned long instruction) {
+InsType getType(unsigned long instruction) {
 	/* 8.1 Get the opcode of the instruction, a certain opcode can decide the type of instruction*/
 	switch (getOpcode(instruction)) {
 			/* 8.2 I-type */
@@ -156,6 +201,7 @@ static InsType getType(unsigned long instruction) {
 		case 0x03: /* I-type instructions are all listed here */
 		case 0x13:
 		case 0x1B:
+		case 0x07: /* flw and fld */
 			return I;
 			/* 8.3 U-type */
 		case 0x17:
@@ -163,10 +209,16 @@ static InsType getType(unsigned long instruction) {
 			return U;
 			/* 8.4 S-type */
 		case 0x23:
+		case 0x27: /* fsw and fsd */
 			return S;
 			/* 8.5 R-type */
 		case 0x33:
 		case 0x3B:
+		case 0x53: /* floating-point arithmetic, the fused ones have rs3 in place of funct7 */
+		case 0x43:
+		case 0x47:
+		case 0x4B:
+		case 0x4F:
 			return R;
 			/* 8.6 SB-type */
 		case 0x63:
@@ -174,10 +226,9 @@ static InsType getType(unsigned long instruction) {
 			/* 8.7 UJ-type */
 		case 0x6F:
 			return UJ;
-			/* 8.8 No such case */
+			/* 8.8 No such case, the caller reports it */
 		default:
-			printf("Error getting type!");
-			exit(0);
+			return UNKNOWN;
 	}
 }
 
@@ -210,202 +261,475 @@ static unsigned long getImm(unsigned long instruction) {
 			return (((instruction >> 25) << 5) | ((instruction >> 7) & 0x1F));
 		case SB:
 			/* 12.5 Imm lies in 31 ~ 25 and 11 ~ 7 in an SB-type instruction */
-			return (((instruction >> 31) << 12) | ((instruction & 0x80) >> 7 << 11) | ((instruction & 0x7E000000) >> 20) | ((instruction & 0xF00) >> 7));
+			return IMM_GATHER_SB(instruction);
 		case U:
 			/* 12.6 Imm lies in 31 ~ 12 in a U-type instruction */
 			return ((instruction >> 12) << 12);
 		case UJ:
-			/* 12.7 Imm lies in 31 ~ 12 in a U-type instruction */
-			return (((instruction & 0x80000000) >> 11) | (((instruction >> 21) & 0x3FF) << 1) | (((instruction >> 20) & 1) << 11) |
-			        ((instruction >> 12) & 0xFF) << 12);
+			/* 12.7 Imm lies in 31 ~ 12 in a UJ-type instruction */
+			return IMM_GATHER_UJ(instruction);
+		default:
+			break;
 	}
 	/* 12.8 Return NON by default */
 	return NON;
 }
 
-static void parse(unsigned long instruction, Instruction *target) {
+int parse(unsigned long instruction, Instruction *target) {
 	/* 13.1 Check validation */
-	if (target == NULL) return;
-	/* 13.2 Original value */
-	target->originalValue = instruction;
-	/* 13.3 Whether it can be compressed */
-	target->inCompressAbleList = isInCompressAbleList(instruction); /* Note: Not guaranteed */
-	/* 13.4 Type of instruction */
+	if (target == NULL) return 1;
+	/* 13.2 Type of instruction */
 	target->type = getType(instruction);
-	/* 13.5 Opcode */
+	/* 13.3 Opcode */
 	target->opcode = getOpcode(instruction);
-	/* 13.6 Funct7 */
+	/* 13.4 Funct7 */
 	target->funct7 = getFunct7(instruction);
-	/* 13.7 Funct3 */
+	/* 13.5 Funct3 */
 	target->funct3 = getFunct3(instruction);
-	/* 13.8 rd */
+	/* 13.6 rd */
 	target->rd = getRD(instruction);
-	/* 13.9 rs1 */
+	/* 13.7 rs1 */
 	target->rs1 = getRS1(instruction);
-	/* 13.10 rs2 */
+	/* 13.8 rs2 */
 	target->rs2 = getRS2(instruction);
-	/* 13.11 imm */
+	/* 13.9 imm */
 	target->imm = getImm(instruction);
+	/* 13.10 Unknown opcodes are still decoded, but reported */
+	return target->type == UNKNOWN;
+}
+
+Program *newProgram(size_t capacity) {
+	/* 14.1 The structure itself and an arena for the given number of instructions */
+	Program *program = malloc(sizeof(Program));
+	if (program == NULL) return NULL;
+	program->count = 0;
+	program->capacity = 0;
+	program->arena = NULL;
+	program->threads = 1;
+	program->invalid = 0;
+	program->isa = 0;
+	program->words = NULL;
+	program->encoded = NULL;
+	program->types = NULL;
+	program->pinned = NULL;
+	if (reserveProgram(program, capacity < 64 ? 64 : capacity)) {
+		free(program);
+		return NULL;
+	}
+	return program;
+}
+
+int reserveProgram(Program *program, size_t capacity) {
+	unsigned char *arena;
+	/* 14.2 One block holds the words, then the 16-bit encodings, then the types */
+	if (capacity <= program->capacity) return 0;
+	arena = malloc(capacity * (sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint8_t)));
+	if (arena == NULL) return 1;
+	/* 14.3 Move what is already there */
+	if (program->count != 0) {
+		memcpy(arena, program->words, program->count * sizeof(uint32_t));
+		memcpy(arena + capacity * sizeof(uint32_t), program->encoded, program->count * sizeof(uint16_t));
+		memcpy(arena + capacity * (sizeof(uint32_t) + sizeof(uint16_t)), program->types, program->count * sizeof(uint8_t));
+	}
+	free(program->arena);
+	program->arena = arena;
+	program->words = (uint32_t *) arena;
+	program->encoded = (uint16_t *) (arena + capacity * sizeof(uint32_t));
+	program->types = arena + capacity * (sizeof(uint32_t) + sizeof(uint16_t));
+	program->capacity = capacity;
+	return 0;
+}
+
+int appendWord(Program *program, unsigned long word) {
+	/* 14.4 Double the capacity when full, so that appending stays amortized O(1) */
+	if (program->count == program->capacity && reserveProgram(program, program->capacity * 2)) return 1;
+	program->words[program->count] = (uint32_t) (word & 0xFFFFFFFF);
+	program->encoded[program->count] = 0;
+	program->types[program->count] = NON;
+	++program->count;
+	return 0;
 }
 
-Instruction **readFromFile(FILE *in) {
-	int i;
-	/* 14.1 Allocate spce for pointers */
-	Instruction **target = malloc(sizeof(Instruction *) * 60);
-	unsigned long *num = malloc(sizeof(unsigned long));
-	for (i = 0; i < 60; ++i) { target[i] = NULL; }
-	/* 14.2 Read in all data with a single loop */
-	for (i = 0; i < 60; ++i) {
-		Instruction *temp = malloc(sizeof(Instruction));
-		/* 14.3 readline() has non-zero return value if something unusual happens */
-		if (!readline(in, num)) {
-			parse(*num, temp);
-			target[i] = temp;
-			continue;
+int mapFile(FILE *in, MappedFile *file, int allowCopy) {
+	struct stat info;
+	file->data = NULL;
+	file->size = 0;
+	file->mapped = 0;
+	/* 20.1 Regular files are mapped, an empty file needs no mapping */
+	if (fstat(fileno(in), &info) == 0 && S_ISREG(info.st_mode)) {
+		void *data;
+		if (info.st_size == 0) return 0;
+		data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+		if (data != MAP_FAILED) {
+			/* 20.2 The file is scanned in order, so tell the kernel to read ahead */
+			posix_madvise(data, (size_t) info.st_size, POSIX_MADV_SEQUENTIAL);
+			file->data = data;
+			file->size = (size_t) info.st_size;
+			file->mapped = 1;
+			return 0;
+		}
+	}
+	if (!allowCopy) return 1;
+	/* 20.3 Pipes and terminals are copied into a growing buffer instead */
+	{
+		size_t capacity = 1 << 16, got;
+		unsigned char *data = malloc(capacity);
+		if (data == NULL) return 1;
+		while ((got = fread(data + file->size, 1, capacity - file->size, in)) > 0) {
+			file->size += got;
+			if (file->size == capacity) {
+				unsigned char *grown = realloc(data, capacity * 2);
+				if (grown == NULL) {
+					free(data);
+					file->size = 0;
+					return 1;
+				}
+				data = grown;
+				capacity *= 2;
+			}
 		}
-		/* 14.4 Finish if nothing else is read */
-		free(temp);
-		break;
+		file->data = data;
+	}
+	return 0;
+}
+
+void unmapFile(MappedFile *file) {
+	/* 21.1 Undo whatever mapFile() did */
+	if (file->mapped) munmap((void *) file->data, file->size);
+	else free((void *) file->data);
+	file->data = NULL;
+	file->size = 0;
+	file->mapped = 0;
+}
+
+static int appendSink(void *context, unsigned long word) { return appendWord(context, word); }
+
+static int streamMapped(const MappedFile *file, WordSink *sink, void *context) {
+	unsigned long num;
+	const char *cursor = (const char *) file->data;
+	/* 14.10 An empty file is not mapped at all */
+	if (cursor == NULL) return 0;
+	while (!parseMappedLine(&cursor, (const char *) file->data + file->size, &num)) {
+		if (sink(context, num)) return 1;
 	}
+	return 0;
+}
 
-	/* 14.5 Free all space allocated */
-	free(num);
-	/* 14.6 Return instructions read */
+int streamFromFile(FILE *in, WordSink *sink, void *context) {
+	unsigned long num;
+	MappedFile file;
+	int err;
+	/* 14.11 Map the whole file when possible */
+	if (!mapFile(in, &file, 0)) {
+		err = streamMapped(&file, sink, context);
+		unmapFile(&file);
+		return err;
+	}
+	/* 14.12 Otherwise read in all data with a single loop */
+	while (!readline(in, &num)) {
+		if (sink(context, num)) return 1;
+	}
+	return 0;
+}
+
+Program *readFromFile(FILE *in) {
+	MappedFile file;
+	int err;
+	/* 14.5 Allocate the program, it grows while reading */
+	Program *target = newProgram(0);
+	if (target == NULL) return NULL;
+	/* 14.6 Map the whole file when possible */
+	if (!mapFile(in, &file, 0)) {
+		/* 14.7 Every line is at least 32 characters, so the size of the file bounds the count */
+		err = reserveProgram(target, file.size / 32 + 1) || streamMapped(&file, appendSink, target);
+		unmapFile(&file);
+	} else {
+		/* 14.8 Otherwise read the stream line by line */
+		err = streamFromFile(in, appendSink, target);
+	}
+	/* 14.9 A program cut short by running out of memory is no program */
+	if (err) {
+		clearAll(target);
+		return NULL;
+	}
 	return target;
 }
 
-static unsigned int generate16bit(Compressed *compressed) {
-	/* 15.1 Print format for every kind of compressed instructions */
-	switch (compressed->type) {
-		case ADD:
-			/* 15.2 CR-format */
-			return ((compressed->funct4 << 12) | (compressed->rd << 7) | (compressed->rs2 << 2) | compressed->opcode);
-		case MV:
-			/* 15.3 CR-format */
-			return ((compressed->funct4 << 12) | (compressed->rd << 7) | (compressed->rs2 << 2) | compressed->opcode);
-		case JR:
-			/* 15.4 CR-format */ /*check... perhaps (compressed->rs2 << 2) also work*/
-			return ((compressed->funct4 << 12) | (compressed->rs1 << 7) | (0x00000 << 2) | compressed->opcode);
-		case JALR:
-			/* 15.5 CR-format */
-			return ((compressed->funct4 << 12) | (compressed->rs1 << 7) | (0x00000 << 2) | compressed->opcode);
-			/*check... perhaps (compressed->rs2 << 2) also work*/
-		case LI:
-			/* 15.6 CI-format */
-			return ((compressed->funct3 << 13) | (((compressed->imm >> 5) & 0x1) << 12) | (compressed->rd << 7) | ((compressed->imm & 0x1F) << 2) |
-			        compressed->opcode);
-		case LUI:
-			/* 15.7 CI-format */
-			return ((compressed->funct3 << 13) | (((compressed->imm >> 5) & 0x1) << 12) | (compressed->rd << 7) | ((compressed->imm & 0x1F) << 2) |
-			        compressed->opcode);
-
-		case ADDI:
-			/* 15.8 CI-format */
-			return ((compressed->funct3 << 13) | (((compressed->imm >> 5) & 0x1) << 12) | (compressed->rd << 7) | ((compressed->imm & 0x1F) << 2) |
-			        compressed->opcode);
-		case SLLI:
-			/* 15.9 CI-format */
-			return ((compressed->funct3 << 13) | (((compressed->imm >> 5) & 0x1) << 12) | (compressed->rd << 7) | ((compressed->imm & 0x1F) << 2) |
-			        compressed->opcode);
-
-		case LW:
-			/* 15.10 CL-format */
-			return ((compressed->funct3 << 13) | (((compressed->imm) & 0xE) >> 1 << 10) | (compressed->rs1 << 7) | ((compressed->imm & 0x1) << 6) |
-			        ((compressed->imm & 0x10) >> 4 << 5) | (compressed->rd << 2) | compressed->opcode);
-
-		case SW:
-			/* 15.11 CS-format-1 */
-			return ((compressed->funct3 << 13) | (((compressed->imm) & 0xE) >> 1 << 10) | (compressed->rs1 << 7) | ((compressed->imm & 0x1) << 6) |
-			        ((compressed->imm & 0x10) >> 4 << 5) | (compressed->rs2 << 2) | compressed->opcode);
-		case AND:
-			/* 15.12 CS-format-2 */
-			return ((compressed->funct6 << 10) | (compressed->rd << 7) | ((compressed->funct2) << 5) | ((compressed->rs2) << 2) | compressed->opcode);
-
-		case OR:
-			/* 15.13 CS-format-2 */
-			return ((compressed->funct6 << 10) | (compressed->rd << 7) | ((compressed->funct2) << 5) | ((compressed->rs2) << 2) | compressed->opcode);
-
-		case XOR:
-			/* 15.14 CS-format-2 */
-			return ((compressed->funct6 << 10) | (compressed->rd << 7) | ((compressed->funct2) << 5) | ((compressed->rs2) << 2) | compressed->opcode);
-
-		case SUB:
-			/* 15.15 CS-format-2 */
-			return ((compressed->funct6 << 10) | (compressed->rd << 7) | ((compressed->funct2) << 5) | ((compressed->rs2) << 2) | compressed->opcode);
-
-		case BEQZ:
-			/* 15.16 CB-format-1 */
-			return ((compressed->funct3 << 13) | ((compressed->imm & 0x100) >> 8 << 12) | (compressed->imm & 0x18) >> 3 << 10 | ((compressed->rs1) << 7) |
-			        (compressed->imm & 0xC0) >> 6 << 5 | (compressed->imm & 0x6) >> 1 << 3 | (compressed->imm & 0x20) >> 5 << 2 | compressed->opcode);
-
-		case BNEZ:
-			/* 15.17 CB-format-1 */
-			return ((compressed->funct3 << 13) | ((compressed->imm & 0x100) >> 8 << 12) | (compressed->imm & 0x18) >> 3 << 10 | ((compressed->rs1) << 7) |
-			        (compressed->imm & 0xC0) >> 6 << 5 | (compressed->imm & 0x6) >> 1 << 3 | (compressed->imm & 0x20) >> 5 << 2 | compressed->opcode);
-
-		case SRLI:
-			/* 15.18 CB-format-2 */
-			return ((compressed->funct3 << 13) | (compressed->imm & 0x20) >> 5 << 12 | (compressed->funct2) << 10 | ((compressed->rd) << 7) |
-			        (compressed->imm & 0x1F) << 2 | compressed->opcode);
-
-		case SRAI:
-			/* 15.19 CB-format-2 */
-			return ((compressed->funct3 << 13) | (compressed->imm & 0x20) >> 5 << 12 | (compressed->funct2) << 10 | ((compressed->rd) << 7) |
-			        (compressed->imm & 0x1F) << 2 | compressed->opcode);
-
-		case ANDI:
-			/* 15.20 CB-format-2 */
-			return ((compressed->funct3 << 13) | (compressed->imm & 0x20) >> 5 << 12 | (compressed->funct2) << 10 | ((compressed->rd) << 7) |
-			        (compressed->imm & 0x1F) << 2 | compressed->opcode);
-
-		case J:
-			/* 15.21 CJ-format */
-			return ((compressed->funct3 << 13) | (compressed->imm & 0x800) >> 11 << 12 | (compressed->imm & 0x10) >> 4 << 11 | ((compressed->imm & 0x300) >> 8 << 9) |
-			        (compressed->imm & 0x400) >> 10 << 8 | (compressed->imm & 0x40) >> 6 << 7 | (compressed->imm & 0x80) >> 7 << 6 |
-			        (compressed->imm & 0xE) >> 1 << 3 | (compressed->imm & 0x20) >> 5 << 2 | compressed->opcode);
-
-		case JAL:
-			/* 15.22 CJ-format */
-			return ((compressed->funct3 << 13) | (compressed->imm & 0x800) >> 11 << 12 | (compressed->imm & 0x10) >> 4 << 11 | ((compressed->imm & 0x300) >> 8 << 9) |
-			        (compressed->imm & 0x400) >> 10 << 8 | (compressed->imm & 0x40) >> 6 << 7 | (compressed->imm & 0x80) >> 7 << 6 |
-			        (compressed->imm & 0xE) >> 1 << 3 | (compressed->imm & 0x20) >> 5 << 2 | compressed->opcode);
+int streamFromBinary(FILE *in, WordSink *sink, void *context) {
+	unsigned char bytes[1 << 16];
+	size_t length, i;
+	/* 23.2 A whole number of words per block, fread() only comes back short at the end of the stream */
+	while ((length = fread(bytes, 1, sizeof(bytes), in)) != 0) {
+		for (i = 0; i + 4 <= length; i += 4) {
+			if (sink(context, (unsigned long) bytes[i] | ((unsigned long) bytes[i + 1] << 8) | ((unsigned long) bytes[i + 2] << 16) |
+			                          ((unsigned long) bytes[i + 3] << 24)))
+				return 1;
+		}
+		if (length < sizeof(bytes)) return 0;
+	}
+	return 0;
+}
 
-		default:
-			/* 15.23 This case should not happen */
-			printf("You shall not reach here!\n");
-			return 0;
+Program *readFromWords(const unsigned char *bytes, size_t length) {
+	size_t i;
+	/* 22.1 Exactly one slot per word */
+	Program *target = newProgram(length / 4);
+	if (target == NULL) return NULL;
+	/* 22.2 Every 4 bytes hold one little-endian word, a trailing partial word is ignored */
+	for (i = 0; i + 4 <= length; i += 4) {
+		if (appendWord(target, (unsigned long) bytes[i] | ((unsigned long) bytes[i + 1] << 8) | ((unsigned long) bytes[i + 2] << 16) |
+		                           ((unsigned long) bytes[i + 3] << 24))) {
+			clearAll(target);
+			return NULL;
+		}
 	}
+	return target;
+}
+
+Program *readFromBinary(FILE *in) {
+	MappedFile file;
+	Program *target;
+	/* 23.1 The whole file is a flat stream of words */
+	if (mapFile(in, &file, 1)) return NULL;
+	target = readFromWords(file.data, file.size);
+	unmapFile(&file);
+	return target;
+}
+
+static unsigned int encodeCR(const Compressed *c) {
+	/* 15.1 CR-format: c.add, c.mv, c.jr, c.jalr */
+	return (unsigned int) ((c->funct4 << 12) | (c->rd << 7) | (c->rs2 << 2) | c->opcode);
+}
+
+static unsigned int encodeCI(const Compressed *c) {
+	/* 15.2 CI-format: c.li, c.lui, c.addi, c.slli */
+	return (unsigned int) ((c->funct3 << 13) | (((c->imm >> 5) & 0x1) << 12) | (c->rd << 7) | ((c->imm & 0x1F) << 2) | c->opcode);
+}
+
+static unsigned int encodeCL(const Compressed *c) {
+	/* 15.3 CL-format: c.lw */
+	return (unsigned int) ((c->funct3 << 13) | IMM_SCATTER_CLS((unsigned long) c->imm) | (c->rs1 << 7) | (c->rd << 2) | c->opcode);
+}
+
+static unsigned int encodeCS(const Compressed *c) {
+	/* 15.4 CS-format-1: c.sw */
+	return (unsigned int) ((c->funct3 << 13) | IMM_SCATTER_CLS((unsigned long) c->imm) | (c->rs1 << 7) | (c->rs2 << 2) | c->opcode);
+}
+
+static unsigned int encodeCA(const Compressed *c) {
+	/* 15.5 CS-format-2: c.and, c.or, c.xor, c.sub */
+	return (unsigned int) ((c->funct6 << 10) | (c->rd << 7) | ((c->funct2) << 5) | ((c->rs2) << 2) | c->opcode);
+}
+
+static unsigned int encodeCB(const Compressed *c) {
+	/* 15.6 CB-format-1: c.beqz, c.bnez */
+	return (unsigned int) ((c->funct3 << 13) | IMM_SCATTER_CB((unsigned long) c->imm) | ((c->rs1) << 7) | c->opcode);
+}
+
+static unsigned int encodeCBI(const Compressed *c) {
+	/* 15.7 CB-format-2: c.srli, c.srai, c.andi */
+	return (unsigned int) ((c->funct3 << 13) | (c->imm & 0x20) >> 5 << 12 | (c->funct2) << 10 | ((c->rd) << 7) | (c->imm & 0x1F) << 2 | c->opcode);
+}
+
+static unsigned int encodeCJ(const Compressed *c) {
+	/* 15.8 CJ-format: c.j, c.jal */
+	return (unsigned int) ((c->funct3 << 13) | IMM_SCATTER_CJ((unsigned long) c->imm) | c->opcode);
+}
+
+static unsigned int encodeCSS(const Compressed *c) {
+	/* 15.9 CSS-format: c.swsp */
+	return (unsigned int) ((c->funct3 << 13) | IMM_SCATTER_CSS((unsigned long) c->imm) | (c->rs2 << 2) | c->opcode);
+}
+
+static unsigned int encodeCIW(const Compressed *c) {
+	/* 15.10 CIW-format: c.addi4spn */
+	return (unsigned int) ((c->funct3 << 13) | IMM_SCATTER_CIW((unsigned long) c->imm) | (c->rd << 2) | c->opcode);
 }
 
-int writeToFile(FILE *out, Instruction **original, Compressed **compressed) {
-	int i;
+static unsigned int encodeCIL(const Compressed *c) {
+	/* 15.11 CI-format with a stack offset: c.lwsp */
+	return (unsigned int) ((c->funct3 << 13) | IMM_SCATTER_CIL((unsigned long) c->imm) | (c->rd << 7) | c->opcode);
+}
+
+static unsigned int encodeCIS(const Compressed *c) {
+	/* 15.12 CI-format with a stack adjustment: c.addi16sp */
+	return (unsigned int) ((c->funct3 << 13) | IMM_SCATTER_CIS((unsigned long) c->imm) | (c->rd << 7) | c->opcode);
+}
+
+static unsigned int encodeCLD(const Compressed *c) {
+	/* 15.13 CL-format with a doubleword offset: c.ld */
+	return (unsigned int) ((c->funct3 << 13) | IMM_SCATTER_CLD((unsigned long) c->imm) | (c->rs1 << 7) | (c->rd << 2) | c->opcode);
+}
+
+static unsigned int encodeCSD(const Compressed *c) {
+	/* 15.14 CS-format with a doubleword offset: c.sd */
+	return (unsigned int) ((c->funct3 << 13) | IMM_SCATTER_CLD((unsigned long) c->imm) | (c->rs1 << 7) | (c->rs2 << 2) | c->opcode);
+}
+
+static unsigned int encodeCILD(const Compressed *c) {
+	/* 15.15 CI-format with a doubleword stack offset: c.ldsp */
+	return (unsigned int) ((c->funct3 << 13) | IMM_SCATTER_CILD((unsigned long) c->imm) | (c->rd << 7) | c->opcode);
+}
+
+static unsigned int encodeCSSD(const Compressed *c) {
+	/* 15.16 CSS-format with a doubleword stack offset: c.sdsp */
+	return (unsigned int) ((c->funct3 << 13) | IMM_SCATTER_CSSD((unsigned long) c->imm) | (c->rs2 << 2) | c->opcode);
+}
+
+static unsigned int encodeCLB(const Compressed *c) {
+	/* 15.17 CL-format with a byte offset: c.lbu */
+	return (unsigned int) ((c->funct6 << 10) | (c->rs1 << 7) | (c->imm & 0x1) << 6 | (c->imm >> 1 & 0x1) << 5 | (c->rd << 2) | c->opcode);
+}
+
+static unsigned int encodeCSB(const Compressed *c) {
+	/* 15.18 CS-format with a byte offset: c.sb */
+	return (unsigned int) ((c->funct6 << 10) | (c->rs1 << 7) | (c->imm & 0x1) << 6 | (c->imm >> 1 & 0x1) << 5 | (c->rs2 << 2) | c->opcode);
+}
+
+static unsigned int encodeCLH(const Compressed *c) {
+	/* 15.19 CL-format with a halfword offset: c.lhu, c.lh */
+	return (unsigned int) ((c->funct6 << 10) | (c->rs1 << 7) | (c->funct2 << 6) | (c->imm >> 1 & 0x1) << 5 | (c->rd << 2) | c->opcode);
+}
+
+static unsigned int encodeCSH(const Compressed *c) {
+	/* 15.20 CS-format with a halfword offset: c.sh */
+	return (unsigned int) ((c->funct6 << 10) | (c->rs1 << 7) | (c->funct2 << 6) | (c->imm >> 1 & 0x1) << 5 | (c->rs2 << 2) | c->opcode);
+}
+
+static unsigned int encodeCU(const Compressed *c) {
+	/* 15.21 CU-format: c.zext.b, c.sext.b, c.zext.h, c.sext.h, c.zext.w, c.not */
+	return (unsigned int) ((c->funct6 << 10) | (c->rd << 7) | (c->funct2 << 5) | (c->funct3 << 2) | c->opcode);
+}
+
+static unsigned int encodeCMPP(const Compressed *c) {
+	/* 15.22 CMPP-format: cm.push, cm.pop, cm.popret */
+	return (unsigned int) ((c->funct6 << 10) | (c->funct2 << 8) | (c->rd << 4) | (c->imm & 0x3) << 2 | c->opcode);
+}
+
+static unsigned int encodeCMMV(const Compressed *c) {
+	/* 15.23 CMMV-format: cm.mvsa01 */
+	return (unsigned int) ((c->funct6 << 10) | (c->rs1 << 7) | (c->funct2 << 5) | (c->rs2 << 2) | c->opcode);
+}
+
+/* One encoder per format, indexed by CFormat */
+static unsigned int (*const encoders[])(const Compressed *) = {encodeCR,   encodeCI,   encodeCL,  encodeCS,  encodeCA,  encodeCB,  encodeCBI, encodeCJ,
+                                                               encodeCSS,  encodeCIW,  encodeCIL, encodeCIS, encodeCLD, encodeCSD, encodeCILD, encodeCSSD,
+                                                               encodeCLB,  encodeCSB,  encodeCLH, encodeCSH, encodeCU,  encodeCMPP, encodeCMMV};
+
+unsigned int generate16bit(const Compressed *compressed) {
+	/* 15.24 The format decides where every field goes, the result is always 16 bits */
+	return encoders[compressed->format](compressed) & 0xFFFF;
+}
+
+/* Text of one block of instructions, formatted by several threads, one buffer each */
+typedef struct TextBlock {
+	const Program *program;
+	/* First instruction of the block */
+	size_t first;
+	OutputBuffer buffers[MAX_THREADS];
+} TextBlock;
+
+/* Instructions of a block per thread, few enough that one buffer never needs to be flushed */
+#define LINES_PER_BUFFER (OUTPUT_BUFFER_SIZE / 33)
+
+static void formatRange(void *context, size_t begin, size_t end, int worker) {
+	TextBlock *block = context;
+	const Program *program = block->program;
+	size_t i;
+	for (i = block->first + begin; i < block->first + end; ++i) {
+		if (program->types[i] == FOLDED) continue;
+		writeline(&block->buffers[worker], program->types[i] == NON ? program->words[i] : program->encoded[i], program->types[i] == NON ? 32 : 16);
+	}
+}
+
+static int writeTextParallel(OutputBuffer *out, const Program *program, int threads) {
+	TextBlock block;
+	int i, failed = 0, allocated;
+	/* 15.7 One buffer per thread, the first is the one of writeToFile() */
+	block.program = program;
+	for (allocated = 0; allocated < threads; ++allocated) {
+		block.buffers[allocated] = *out;
+		if (allocated != 0) block.buffers[allocated].data = malloc(OUTPUT_BUFFER_SIZE);
+		if (block.buffers[allocated].data == NULL) break;
+	}
+	/* 15.8 Without memory for the other buffers, fewer threads do the work */
+	threads = allocated;
+	for (block.first = 0; block.first < program->count && !failed; block.first += (size_t) threads * LINES_PER_BUFFER) {
+		size_t size = program->count - block.first;
+		if (size > (size_t) threads * LINES_PER_BUFFER) size = (size_t) threads * LINES_PER_BUFFER;
+		/* 15.9 Format the block in parallel, then write the buffers in order so that the output is the same as with one thread */
+		parallelFor(threads, size, formatRange, &block);
+		for (i = 0; i < threads; ++i) {
+			flushOutput(&block.buffers[i]);
+			failed |= block.buffers[i].failed;
+		}
+	}
+	for (i = 1; i < allocated; ++i) free(block.buffers[i].data);
+	return failed;
+}
+
+int writeToFile(FILE *out, const Program *program) {
+	OutputBuffer buffer;
+	size_t i;
 	/* 15.1 Check validation */
-	if (out == NULL || original == NULL || compressed == NULL) return 1;
-	/* 15.2 Print to file in a loop */
-	for (i = 0; i < 60; ++i) {
-		/* 15.3 If all instructions are written */
-		if (original[i] == NULL) return 0;
-		if (compressed[i] == NULL) {
-			/* 15.4 This instruction cannot be compressed */
-			writeline(out, original[i]->originalValue, 32);
-		} else {
-			/* 15.5 Generate a compressed instruction */
-			writeline(out, generate16bit(compressed[i]), 16);
+	if (out == NULL || program == NULL) return 1;
+	/* 15.2 Buffer for the whole output */
+	if (openOutput(&buffer, out) != 0) return 2;
+	if (program->threads > 1) {
+		/* 15.3 Several threads format the text, one block at a time */
+		buffer.failed = writeTextParallel(&buffer, program, program->threads > MAX_THREADS ? MAX_THREADS : program->threads);
+	} else {
+		/* 15.4 Print to the buffer in a loop, until all instructions are written */
+		for (i = 0; i < program->count; ++i) {
+			if (program->types[i] == NON) {
+				/* 15.5 This instruction cannot be compressed */
+				writeline(&buffer, program->words[i], 32);
+			} else if (program->types[i] != FOLDED) {
+				/* 15.6 The compressed instruction is already encoded */
+				writeline(&buffer, program->encoded[i], 16);
+			}
 		}
 	}
-	/* 15.6 We should not reach here */
-	printf("Reached the end of array!\n");
-	return 0;
+	/* 15.10 Write out what is left and release the buffer */
+	return closeOutput(&buffer);
 }
 
-void clearAll(Instruction **pInstruction, Compressed **pCompressed) {
-	int i;
-	/* 16.1 This function is aimed to avoid any possible mem-leaks */
-	for (i = 0; i < 60; ++i) {
-		if (pInstruction[i]) free(pInstruction[i]);
-		if (pCompressed[i]) free(pCompressed[i]);
+size_t encodeToBytes(const Program *program, unsigned char *out) {
+	size_t i, length = 0;
+	/* 24.1 Compressed instructions take one little-endian parcel, the others take two, FOLDED ones none */
+	for (i = 0; i < program->count; ++i) {
+		unsigned long value;
+		if (program->types[i] == FOLDED) continue;
+		value = program->types[i] == NON ? program->words[i] : program->encoded[i];
+		out[length++] = (unsigned char) (value & 0xFF);
+		out[length++] = (unsigned char) ((value >> 8) & 0xFF);
+		if (program->types[i] == NON) {
+			out[length++] = (unsigned char) ((value >> 16) & 0xFF);
+			out[length++] = (unsigned char) ((value >> 24) & 0xFF);
+		}
 	}
-	/* 16.2 Don't forget to free the space taken by structures */
-	free(pInstruction);
-	free(pCompressed);
+	return length;
+}
+
+int writeToBinary(FILE *out, const Program *program) {
+	unsigned char *bytes;
+	size_t length;
+	int err = 0;
+	/* 25.1 Check validation */
+	if (out == NULL || program == NULL) return 1;
+	/* 25.2 The output is never larger than 4 bytes per instruction */
+	bytes = malloc(4 * program->count + 1);
+	if (bytes == NULL) return 2;
+	length = encodeToBytes(program, bytes);
+	if (fwrite(bytes, 1, length, out) != length) err = 2;
+	free(bytes);
+	return err;
+}
+
+void clearAll(Program *program) {
+	/* 16.1 This function is aimed to avoid any possible mem-leaks, everything lives in one arena */
+	if (program == NULL) return;
+	free(program->pinned);
+	free(program->arena);
+	free(program);
 }
@@ -1,16 +1,55 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* A whole input file, either mapped or copied into memory */
+typedef struct MappedFile {
+	/* Content of the file */
+	const unsigned char *data;
+	/* Number of bytes in data */
+	size_t size;
+	/* 1 if data is mapped, 0 if it is a heap copy */
+	int mapped;
+} MappedFile;
 
 /* All kinds of instruction */
-typedef enum InsType { I = 1, U, S, R, SB, UJ } InsType;
+typedef enum InsType { UNKNOWN = 0, I = 1, U, S, R, SB, UJ } InsType;
+
+/* All kinds of compressed instruction, c.sb and c.sh are SBYTE and SHALF since SB is an InsType.
+ * PUSH, POP, POPRET and MVSA01 (Zcmp) each replace a run of instructions, the ones after the first are FOLDED into it */
+typedef enum Ctype { NON = 0, ADD = 1, MV, JR, JALR, LI, LUI, ADDI, SLLI, LW, SW, AND, OR, XOR, SUB, BEQZ, BNEZ, SRLI, SRAI, ANDI, J, JAL, LWSP, SWSP, ADDI16SP, ADDI4SPN, LD, SD, LDSP, SDSP, ADDIW, ADDW, SUBW, FLW, FSW, FLWSP, FSWSP, FLD, FSD, FLDSP, FSDSP,
+                    LBU, LHU, LH, SBYTE, SHALF, ZEXTB, SEXTB, ZEXTH, SEXTH, ZEXTW, NOT, MUL, PUSH, POP, POPRET, MVSA01, FOLDED } Ctype;
+
+/* Bytes an instruction of a Ctype takes in the compressed code */
+#define COMPRESSED_SIZE(type) ((type) == NON ? 4 : (type) == FOLDED ? 0 : 2)
+
+/* All formats of compressed instruction, CA is CS-format-2 and CBI is CB-format-2,
+ * CIL (c.lwsp) and CIS (c.addi16sp) are CI-format with the immediate bits of the stack pointer forms,
+ * CLD, CSD, CILD and CSSD are CL, CS, CIL and CSS with the doubleword offsets of c.ld, c.sd, c.ldsp and c.sdsp,
+ * the floating-point loads and stores share the formats of the integer ones with the same offsets,
+ * CLB, CSB, CLH and CSH are the byte and halfword loads and stores of Zcb (funct6 in 15 ~ 10, funct2 holds bit 6 of c.lh),
+ * CU is CA with funct2 11 and the funct3 of the Zcb unary operation in 4 ~ 2,
+ * CMPP (cm.push, cm.pop, cm.popret) holds the register list in rd and the 16-byte steps of extra stack in imm,
+ * CMMV (cm.mvsa01) holds r1s' in rs1 and r2s' in rs2 */
+typedef enum CFormat { CR = 0, CI, CL, CS, CA, CB, CBI, CJ, CSS, CIW, CIL, CIS, CLD, CSD, CILD, CSSD, CLB, CSB, CLH, CSH, CU, CMPP, CMMV } CFormat;
 
-/* All kinds of compressed instruction */
-typedef enum Ctype { NON = 0, ADD = 1, MV, JR, JALR, LI, LUI, ADDI, SLLI, LW, SW, AND, OR, XOR, SUB, BEQZ, BNEZ, SRLI, SRAI, ANDI, J, JAL } Ctype;
+/* Instruction sets the code may be compressed for, 0 is RV32C and every flag adds to it */
+#define ISA_RV64 0x1 /* RV64C (--xlen=64): c.ld, c.sd, c.ldsp, c.sdsp, c.addiw, c.addw and c.subw, no c.jal */
+#define ISA_F 0x2    /* F extension: c.flw, c.fsw, c.flwsp and c.fswsp, only without ISA_RV64 which has c.ld in their place */
+#define ISA_D 0x4    /* D extension: c.fld, c.fsd, c.fldsp and c.fsdsp */
+#define ISA_ZCB 0x8  /* Zcb: c.lbu, c.lhu, c.lh, c.sb, c.sh, c.zext.b/h/w, c.sext.b/h, c.not and c.mul */
+#define ISA_ZCMP 0x10 /* Zcmp: cm.push, cm.pop, cm.popret and cm.mvsa01, in the encodings of ISA_D which is left out with it */
+/* Every flag at once, instruction sets are 0 ~ ISA_ALL */
+#define ISA_ALL (ISA_RV64 | ISA_F | ISA_D | ISA_ZCB | ISA_ZCMP)
 
 typedef struct Compressed {
 	/* The type of compressed instruction */
 	Ctype type;
+	/* The format of compressed instruction, decides how fields are placed */
+	CFormat format;
 	/* 1 ~ 0 bit of compressed instruction */
 	short opcode;
 	/* 15 ~ 12 bit of compressed instruction */
@@ -32,10 +71,6 @@ typedef struct Compressed {
 } Compressed;
 
 typedef struct Instruction {
-	/* Original value of instruction */
-	unsigned long originalValue;
-	/* Whether the instruction can be compressed */
-	int inCompressAbleList;
 	/* The type of instruction */
 	InsType type;
 	/* opcode */
@@ -54,6 +89,46 @@ typedef struct Instruction {
 	unsigned long imm;
 } Instruction;
 
+/* All instructions of one input, as parallel arrays inside a single arena */
+typedef struct Program {
+	/* Original value of every instruction, relocated branches are rewritten in place */
+	uint32_t *words;
+	/* Encoded compressed instruction, only meaningful where types[i] is not NON */
+	uint16_t *encoded;
+	/* Ctype of every instruction, NON if it stays 32-bit */
+	uint8_t *types;
+	/* Number of instructions */
+	size_t count;
+	/* Number of slots in the arena */
+	size_t capacity;
+	/* The one allocation behind words, encoded and types */
+	void *arena;
+	/* Number of threads the passes over the program may use, 1 by default */
+	int threads;
+	/* Index of the first instruction with an unknown opcode, count if there is none, set by primaryCompression() */
+	size_t invalid;
+	/* Instruction set the code is compressed for, ISA_* flags, 0 (RV32C) by default */
+	unsigned int isa;
+	/* Non-zero for every instruction that must stay 32-bit whatever it is, NULL if there is none, freed by clearAll() */
+	uint8_t *pinned;
+} Program;
+
+/* Buffered output of writeToFile(), flushed with write() whenever it is full */
+typedef struct OutputBuffer {
+	/* Stream written to, only used when it has no file descriptor */
+	FILE *stream;
+	/* File descriptor of the stream, -1 if there is none */
+	int fd;
+	/* Buffered bytes and how many of them are used */
+	char *data;
+	size_t used;
+	/* Set once a write has failed */
+	int failed;
+} OutputBuffer;
+
+/* Receives the instructions of a stream one by one, returns non-zero to stop reading */
+typedef int WordSink(void *context, unsigned long word);
+
 /*  int readline(FILE *in, unsigned long *target):
  *
  *  Input:
@@ -65,25 +140,53 @@ typedef struct Instruction {
  *          0: When nothing unusual happened.
  *          1: When some input values are invalid.
  *          2: When failed to read from FILE *in.
+ *      Only the first 32 characters of a line are converted, the rest is dropped.
  *      unsigned long *target
  *          0: When something unusual happens.
  *          result: In most usual cases.
  */
 
-/*  int writeline(FILE *out, unsigned long target, int length):
+/*  int openOutput(OutputBuffer *out, FILE *stream):
  *
  *  Input:
- *      FILE *out: Valid writable filestream.
+ *      OutputBuffer *out: Receives the buffer, release it with closeOutput().
+ *      FILE *stream: Valid writable filestream, not to be used through stdio until closeOutput().
+ *
+ *  Output:
+ *      int:
+ *          0: In most usual cases.
+ *          2: When the stream cannot be flushed or the buffer cannot be allocated.
+ */
+int openOutput(OutputBuffer *out, FILE *stream);
+
+/*  void writeline(OutputBuffer *out, unsigned long target, int length):
+ *
+ *  Input:
+ *      OutputBuffer *out: Buffer returned by openOutput().
  *      unsigned long target: An instruction that is ready for writing.
  *      int length: 16 / 32, depending on whether the instruction is compressed.
  *
  *  Output:
+ *      Appends the digits of the instruction followed by a newline, one byte at a time
+ *      through a table of 256 eight-character strings.
+ */
+void writeline(OutputBuffer *out, unsigned long target, int length);
+
+/*  void writeParcels(OutputBuffer *out, unsigned long target, int length):
+ *
+ *  Same as writeline(), but appends the 2 / 4 little-endian bytes of the instruction.
+ */
+void writeParcels(OutputBuffer *out, unsigned long target, int length);
+
+/*  int closeOutput(OutputBuffer *out):
+ *
+ *  Output:
+ *      Writes out what is left and releases the buffer.
  *      int:
- *          0: In most usual cases.
- *          1: When some input values are invalid.
- *          2: Invalid value of length, the value is only possible to be 16 / 32.
- *          3: The function fputc() has encountered unprecedented failure.
+ *          0: When every write has succeeded.
+ *          2: Otherwise.
  */
+int closeOutput(OutputBuffer *out);
 
 /*  unsigned long stringToBinaryNumber(const char *instruction):
  *
@@ -126,17 +229,6 @@ typedef struct Instruction {
  *          result: An 7-bit number.
  */
 
-/*  int inCompressAbleList(unsigned long instruction):
- *
- *  Input:
- *      unsigned long instruction: A 32-bit binary number.
- *
- *  Output:
- *      int:
- *          0: When the instruction cannot be compressed.
- *          1: When the instruction can be compressed.
- */
-
 /*  InsType getType(unsigned long instruction):
  *
  *  Input:
@@ -145,7 +237,9 @@ typedef struct Instruction {
  *  Output:
  *      InsType:
  *          result: The type of instruction.
+ *          UNKNOWN: When the opcode is neither a RV64I one nor one of the F and D extensions.
  */
+InsType getType(unsigned long instruction);
 
 /*  short getRD(unsigned long instruction):
  *
@@ -187,7 +281,7 @@ typedef struct Instruction {
  *          result: Imm (if exists) in the instruction.
  */
 
-/*  void parse(unsigned long instruction):
+/*  int parse(unsigned long instruction, Instruction *target):
  *
  *  Input:
  *      unsigned long instruction: A 32-bit binary number.
@@ -195,34 +289,165 @@ typedef struct Instruction {
  *  Output:
  *      Instruction* target:
  *          result: Detailed information about the instruction.
+ *      int:
+ *          0: In most usual cases.
+ *          1: When the opcode is unknown (target->type is UNKNOWN) or target is NULL.
+ */
+int parse(unsigned long instruction, Instruction *target);
+
+/*  Program *newProgram(size_t capacity):
+ *
+ *  Input:
+ *      size_t capacity: Expected number of instructions, the program still grows past it.
+ *
+ *  Output:
+ *      Program *:
+ *          result: An empty program, release it with clearAll().
+ *          NULL: When it cannot be allocated.
+ */
+Program *newProgram(size_t capacity);
+
+/*  int reserveProgram(Program *program, size_t capacity):
+ *
+ *  Input:
+ *      Program *program: Program returned by newProgram().
+ *      size_t capacity: Number of slots needed, the arena is moved once if it is smaller.
+ *
+ *  Output:
+ *      int:
+ *          0: When there is room for capacity instructions.
+ *          1: When out of memory, program is left unchanged.
  */
+int reserveProgram(Program *program, size_t capacity);
 
-/*  Instruction **readFromFile(FILE *in):
+/*  int appendWord(Program *program, unsigned long word):
+ *
+ *  Input:
+ *      Program *program: Program returned by newProgram().
+ *      unsigned long word: A 32-bit instruction, appended as not compressed.
+ *
+ *  Output:
+ *      int:
+ *          0: In most usual cases.
+ *          1: When out of memory.
+ */
+int appendWord(Program *program, unsigned long word);
+
+/*  Program *readFromFile(FILE *in):
+ *
+ *  Input:
+ *      FILE *in: Valid readable filestream. Regular files are memory mapped and parsed
+ *                8 characters at a time, other streams are read with readline().
+ *                Blank characters around each line (including CRLF) are ignored.
+ *
+ *  Output:
+ *      Program *:
+ *          result: Original instructions of any length, decoded later by primaryCompression().
+ *          NULL: When the program cannot be allocated or runs out of memory while it grows.
+ */
+Program *readFromFile(FILE *in);
+
+/*  int streamFromFile(FILE *in, WordSink *sink, void *context):
+ *
+ *  Same as readFromFile(), but hands every instruction to sink(context, word) as soon as it is read
+ *  instead of keeping it, until the end of the stream or until sink() returns non-zero.
+ *  Returns 0 at the end of the stream, 1 when sink() stopped it.
+ */
+int streamFromFile(FILE *in, WordSink *sink, void *context);
+
+/*  int streamFromBinary(FILE *in, WordSink *sink, void *context):
+ *
+ *  Same as streamFromFile(), for a flat little-endian word stream (.bin) read block by block.
+ */
+int streamFromBinary(FILE *in, WordSink *sink, void *context);
+
+/*  Program *readFromWords(const unsigned char *bytes, size_t length):
+ *
+ *  Input:
+ *      const unsigned char *bytes: Raw instructions, one little-endian 32-bit word after another.
+ *      size_t length: Number of bytes, a trailing partial word is ignored.
+ *
+ *  Output:
+ *      Program *:
+ *          result: Same as readFromFile().
+ *          NULL: When out of memory.
+ */
+Program *readFromWords(const unsigned char *bytes, size_t length);
+
+/*  Program *readFromBinary(FILE *in):
+ *
+ *  Input:
+ *      FILE *in: Valid readable filestream holding a flat little-endian word stream (.bin).
+ *
+ *  Output:
+ *      Program *:
+ *          result: Same as readFromFile().
+ *          NULL: When the file cannot be read or memory runs out.
+ */
+Program *readFromBinary(FILE *in);
+
+/*  int mapFile(FILE *in, MappedFile *file, int allowCopy):
  *
  *  Input:
  *      FILE *in: Valid readable filestream.
+ *      MappedFile *file: Receives the content, release it with unmapFile().
+ *      int allowCopy: Whether streams that cannot be mapped are copied into memory instead.
  *
  *  Output:
- *      Instruction **:
- *          result: An array of original instructions with length 60.
+ *      int:
+ *          0: When file holds the whole content (data is NULL for an empty file).
+ *          1: When the stream cannot be mapped (and allowCopy is 0) or read.
  */
-Instruction **readFromFile(FILE *in);
+int mapFile(FILE *in, MappedFile *file, int allowCopy);
+
+void unmapFile(MappedFile *file);
 
-/*  int writeToFile(FILE *out, Instruction **original, Compressed **compressed):
+/*  int writeToFile(FILE *out, const Program *program):
  *
  *  Input:
  *      FILE *out: Valid writable filestream.
- *      Instruction **original: All original, uncompressed instructions.
- *      Compressed **compressed: All compressed instructions.
+ *      const Program *program: All instructions, after primaryCompression() and confirmAddress().
  *
  *  Output:
+ *      FOLDED instructions are left out, the compressed instruction before them stands for them.
  *      int:
  *          0: In most usual cases.
  *          1: When some input values are invalid.
+ *          2: When the output cannot be written.
+ *
+ */
+int writeToFile(FILE *out, const Program *program);
+
+/*  size_t encodeToBytes(const Program *program, unsigned char *out):
  *
+ *  Input:
+ *      const Program *program: All instructions, after primaryCompression() and confirmAddress().
+ *      unsigned char *out: Room for at least 4 bytes per instruction.
+ *
+ *  Output:
+ *      size_t:
+ *          result: Number of bytes written, as little-endian 16-bit and 32-bit instructions.
+ */
+size_t encodeToBytes(const Program *program, unsigned char *out);
+
+/*  int writeToBinary(FILE *out, const Program *program):
+ *
+ *  Same as writeToFile(), but writes the bytes of encodeToBytes() instead of text.
+ */
+int writeToBinary(FILE *out, const Program *program);
+
+/*  unsigned int generate16bit(const Compressed *compressed):
+ *
+ *  Input:
+ *      const Compressed *compressed: A compressed instruction with all fields set.
+ *
+ *  Output:
+ *      unsigned int:
+ *          result: The 16-bit encoding, placed according to compressed->format.
  */
-int writeToFile(FILE *out, Instruction **original, Compressed **compressed);
+unsigned int generate16bit(const Compressed *compressed);
 
-void clearAll(Instruction **pInstruction, Compressed **pCompressed);
+/* Frees the arena and the program in one go */
+void clearAll(Program *program);
 
 #endif
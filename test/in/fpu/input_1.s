@@ -0,0 +1,17 @@
+00000100000001000000000001100011
+00000000000001001010010000000111
+00000111110001000010011110000111
+00001000000001001010010000000111
+00001111110000010010000000000111
+00010000000000010010000010000111
+00000000100101000010001000100111
+00000001111100010010000000100111
+00001111100001001011010000000111
+00000000010001001011010000000111
+00011111100000010011000010000111
+00000000100101000011010000100111
+00011110000000010011110000100111
+00000000000100010011011000100111
+00000000001100010111000011010011
+00100010001100010111000011000011
+00000000010001001010010000000011
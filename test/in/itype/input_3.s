@@ -0,0 +1,19 @@
+00000000000000010010000010000011
+00001111110000010010111110000011
+00000000100000010010010010000011
+00000000010000010010000000000011
+00010000000000010010001010000011
+00000000011000010010001010000011
+11111111110000010010001010000011
+11100000000000010000000100010011
+00011111000000010000000100010011
+11111110000000010000000100010011
+00000001000000010000000100010011
+00100000000000010000000100010011
+00000010100000010000000100010011
+00000000010000010000010000010011
+00111111110000010000011110010011
+01000000000000010000010000010011
+00000000100000010000001010010011
+00000000000000010000010000010011
+00000000011000010000010000010011
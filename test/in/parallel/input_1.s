@@ -0,0 +1,66 @@
+00010000000001000000001001100011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000000001000000001100111
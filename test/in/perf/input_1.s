@@ -0,0 +1,129 @@
+00000000011100110000001010110011
+00011110000001000000111001100011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+11100000000001001001001011100011
+00000000000000001000000001100111
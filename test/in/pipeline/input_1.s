@@ -0,0 +1,7 @@
+00000000000000000000001010110011
+11111111111101011000010110010011
+00000000101000101000001010110011
+11111111111101011000010110010011
+11111110000001011101110011100011
+00000000010100000000010100110011
+00000000000000001000000001100111	
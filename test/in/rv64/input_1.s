@@ -0,0 +1,26 @@
+00000000110000000000000011101111
+00000000000001001011010000000011
+00001111100001000011011110000011
+11111110000000101000001010011011
+00000000000000101000001010011011
+11111111100111111111000001101111
+00010000000001001011010000000011
+00000000010001001011010000000011
+00011111100000010011000010000011
+00000000100000010011000000000011
+00100000000000010011000010000011
+00000000100101000011010000100011
+00000000000100010011000000100011
+00011110000000010011110000100011
+00000000000100010011011000100011
+00000000000100110000001010011011
+00000000000100000000000000011011
+00000010000000101000001010011011
+00000000100101000000010000111011
+01000000111001111000011110111011
+00000000101001001000010000111011
+00000000100100101000001010111011
+00000010100000101001001010010011
+01000011111101000101010000010011
+00000010000101001101010010010011
+00000000010001001010010000000011
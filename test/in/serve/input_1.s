@@ -0,0 +1,64 @@
+00110110110000000000000001101111
+11111111110111111111000011101111
+00000000000101000000010000010011
+00001011010000000000000001101111
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000100000001000000001001100011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00100110000000000000000001101111
+00000000000101000000010000010011
+11111101000111111111000011101111
+00010000000001000000001001100011
+00001100000001000000101001100011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00011011110000000000000001101111
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000110000001000000010001100011
+00000010000001000000101001100011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+11111100000001000000111011100011
+11110110110111111111000011101111
+00000000000101000000010000010011
+11110110010111111111000011101111
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000001000000000001100011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+11110100010111111111000011101111
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+11111000000001000000011011100011
+00000000000101000000010000010011
+00000000000101000000010000010011
+11110110000001000001010011100011
+11110100000001000001111011100011
+00000000000101000000010000010011
+00000000000101000000010000010011
+00000000000101000000010000010011
+11110001010111111111000011101111
+11110001000111111111000011101111
+00000000000101000000010000010011
+00000000000101000000010000010011
+00011001010000000000000001101111
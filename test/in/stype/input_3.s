@@ -0,0 +1,6 @@
+00000000000100010010000000100011
+00001110000000010010111000100011
+00000010100100010010111000100011
+00010000000100010010000000100011
+11111110000100010010111000100011
+00000000000100010010000100100011
@@ -0,0 +1,21 @@
+00000101000000000000000001101111
+00000000001101001100010000000011
+00000000010001001100010000000011
+00000000000001001100001010000011
+00000000001001011101010100000011
+00000000000001101001011000000011
+00000000000101101001011000000011
+00000000000001001000010000000011
+00000000111001111000000010100011
+00000000100001001001000100100011
+00000000100001001001000110100011
+00001111111101000111010000010011
+00000001111101000111010000010011
+01100000010001001001010010010011
+01100000010101010001010100010011
+00001000000001011100010110110011
+11111111111101100100011000010011
+11111111111101101100011000010011
+00000010111001101000011010110011
+00000010110101110000011010110011
+00000010011000101000001010110011
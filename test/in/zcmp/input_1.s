@@ -0,0 +1,27 @@
+00000110100000000000000001101111
+00000100101101010000001001100011
+11111111000000010000000100010011
+00000000000100010010001000100011
+00000000100000010010010000100011
+00000000100100010010011000100011
+00000000000001010000010000010011
+00000000000001011000010010010011
+11111110000000010000000100010011
+00000000000100010010111000100011
+11111111000000010000000100010011
+00000000100000010010010000100011
+00000000000001010000010000010011
+00000000000001011000010000010011
+00000000100000010010000010000011
+00000000110000010010010000000011
+00000001000000010000000100010011
+00000000110000010010000010000011
+00000001000000010000000100010011
+00000000000000001000000001100111
+00000000000000010010000010000011
+00000000010000010010010000000011
+00000000100000010010010010000011
+00000000110000010010100100000011
+00000001000000010000000100010011
+00000000000000001000000001100111
+00000000011100110000001010110011
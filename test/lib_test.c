@@ -0,0 +1,103 @@
+/*  Test of the library API: compresses a flat word stream (.bin) with rvc_compress() and writes
+    the result in the text format of the translator, so that it can be compared with the same refs.
+    rvc_compact() has to produce the same bytes in place.
+
+    Usage: lib_test <input .bin> <output .s>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../rvc.h"
+
+static void writeBits(FILE *out, unsigned long value, int length) {
+	int bit;
+	for (bit = length - 1; bit >= 0; --bit) fputc((value >> bit) & 1 ? '1' : '0', out);
+	fputc('\n', out);
+}
+
+/* The contract of rvc_compress() besides the output itself, returns the number of failed checks */
+static int checkErrors(const uint32_t *words, size_t n, size_t expected) {
+	uint32_t invalid[3] = {0x00000013, 0x00000013, 0xFFFFFFFF};
+	size_t length = 0;
+	rvc_stats stats;
+	int failed = 0;
+	/* 1. Asking for the size only */
+	failed += rvc_compress(words, n, NULL, &length, &stats) != RVC_ERR_SPACE || length != expected;
+	/* 2. Bad arguments */
+	failed += rvc_compress(NULL, 1, NULL, &length, NULL) != RVC_ERR_ARGUMENT;
+	failed += rvc_compress(words, n, NULL, NULL, NULL) != RVC_ERR_ARGUMENT;
+	/* 3. An unknown opcode is reported, not fatal */
+	length = sizeof(invalid);
+	failed += rvc_compress(invalid, 3, (uint8_t *) invalid, &length, &stats) != RVC_ERR_INSTRUCTION || stats.invalid != 2 || length != 0;
+	return failed;
+}
+
+/* rvc_compact() on copies of words, with and without a map, returns the number of failed checks */
+static int checkCompact(const uint32_t *words, size_t n, const uint8_t *expected, size_t length) {
+	uint32_t *code = malloc(sizeof(uint32_t) * (n + 1));
+	uint32_t *map = malloc(sizeof(uint32_t) * (n + 1));
+	size_t compacted, i;
+	rvc_stats stats;
+	int failed = 0, pass;
+	if (code == NULL || map == NULL) return 1;
+	for (pass = 0; pass < 2; ++pass) {
+		for (i = 0; i < n; ++i) code[i] = words[i];
+		/* 1. Same bytes as rvc_compress(), the map marks where every instruction went */
+		failed += rvc_compact(code, n, &compacted, pass ? map : NULL, &stats) != RVC_OK || compacted != length;
+		failed += stats.bytes_out != length || stats.bytes_in - stats.bytes_out != 2 * stats.compressed;
+		for (i = 0; !failed && i < length; ++i) failed += ((uint8_t *) code)[i] != expected[i];
+		for (i = 0; pass && !failed && i < n; ++i) failed += map[i + 1] - map[i] != 2 && map[i + 1] - map[i] != 4;
+		failed += pass && map[n] != length;
+	}
+	free(code);
+	free(map);
+	return failed;
+}
+
+int main(int argc, char **argv) {
+	FILE *in, *out;
+	uint32_t *words;
+	uint8_t *bytes;
+	size_t n = 0, length, i;
+	rvc_stats stats;
+	unsigned char word[4];
+	int err, failed;
+	if (argc != 3) return 2;
+	in = fopen(argv[1], "rb");
+	out = fopen(argv[2], "w");
+	if (in == NULL || out == NULL) return 2;
+	/* 1. Read the words */
+	words = malloc(sizeof(uint32_t) * (1 << 20));
+	while (words != NULL && n < (1 << 20) && fread(word, 1, 4, in) == 4) {
+		words[n++] = (uint32_t) word[0] | (uint32_t) word[1] << 8 | (uint32_t) word[2] << 16 | (uint32_t) word[3] << 24;
+	}
+	/* 2. Compress into a buffer of the largest size */
+	length = rvc_compress_bound(n);
+	bytes = malloc(length + 1);
+	if (words == NULL || bytes == NULL) return 2;
+	err = rvc_compress(words, n, bytes, &length, &stats);
+	if (err != RVC_OK) fprintf(stderr, "rvc_compress: %s\n", rvc_strerror(err));
+	/* 3. Check the rest of the API, a failure leaves the output empty */
+	failed = checkErrors(words, n, length);
+	if (err == RVC_OK) failed += checkCompact(words, n, bytes, length);
+	failed += stats.instructions != n || stats.bytes_out != length || stats.bytes_in - stats.bytes_out != 2 * stats.compressed;
+	if (failed) fprintf(stderr, "%d checks of the API failed\n", failed);
+	/* 4. Write it out as text, parcel by parcel */
+	for (i = 0; err == RVC_OK && !failed && i + 2 <= length;) {
+		unsigned long value = (unsigned long) bytes[i] | (unsigned long) bytes[i + 1] << 8;
+		if ((value & 0x3) == 0x3) {
+			value |= (unsigned long) bytes[i + 2] << 16 | (unsigned long) bytes[i + 3] << 24;
+			writeBits(out, value, 32);
+			i += 4;
+		} else {
+			writeBits(out, value, 16);
+			i += 2;
+		}
+	}
+	free(words);
+	free(bytes);
+	fclose(in);
+	fclose(out);
+	return err != RVC_OK || failed != 0;
+}
@@ -0,0 +1,7 @@
+00000000000000000000001010110011
+0001010111111101
+1001001010101010
+0001010111111101
+11111110000001011101111011100011
+1000010100010110
+1000000010000010
@@ -0,0 +1,39 @@
+Translation process completed successfully.
+ 7f 45 4c 46 01 01 01 00 00 00 00 00 00 00 00 00
+ 01 00 f3 00 01 00 00 00 00 00 00 00 00 00 00 00
+ 34 01 00 00 01 00 00 00 34 00 00 00 00 00 28 00
+ 07 00 01 00 ef 00 00 00 63 00 05 00 b3 02 00 00
+ fd 15 aa 92 fd 15 e3 de 05 fe 11 c1 16 85 82 80
+ 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00
+ 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00
+ 00 00 00 00 00 00 00 00 13 00 00 00 0e 00 00 00
+ 00 00 00 00 00 00 02 00 1e 00 00 00 1a 00 00 00
+ 00 00 00 00 00 00 02 00 0c 00 00 00 00 00 00 00
+ 1c 00 00 00 12 00 02 00 08 00 00 00 00 00 00 00
+ 00 00 00 00 10 00 00 00 00 00 00 00 11 04 00 00
+ 00 00 00 00 04 00 00 00 10 04 00 00 00 00 00 00
+ 00 00 00 00 01 01 00 00 00 00 00 00 04 00 00 00
+ 01 02 00 00 00 00 00 00 08 00 00 00 01 03 00 00
+ 18 00 00 00 00 2e 72 65 6c 61 2e 74 65 78 74 00
+ 5f 73 74 61 72 74 00 61 63 63 75 6d 75 6c 61 74
+ 65 00 2e 4c 64 6f 6e 65 00 2e 73 74 72 74 61 62
+ 00 2e 73 79 6d 74 61 62 00 2e 72 65 6c 61 2e 64
+ 61 74 61 00 00 00 00 00 00 00 00 00 00 00 00 00
+ 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00
+ 00 00 00 00 00 00 00 00 00 00 00 00 25 00 00 00
+ 03 00 00 00 00 00 00 00 00 00 00 00 f4 00 00 00
+ 40 00 00 00 00 00 00 00 00 00 00 00 01 00 00 00
+ 00 00 00 00 06 00 00 00 01 00 00 00 06 00 00 00
+ 00 00 00 00 34 00 00 00 1c 00 00 00 00 00 00 00
+ 00 00 00 00 04 00 00 00 00 00 00 00 01 00 00 00
+ 04 00 00 00 40 00 00 00 00 00 00 00 b8 00 00 00
+ 18 00 00 00 06 00 00 00 02 00 00 00 04 00 00 00
+ 0c 00 00 00 3a 00 00 00 01 00 00 00 03 00 00 00
+ 00 00 00 00 5c 00 00 00 0c 00 00 00 00 00 00 00
+ 00 00 00 00 01 00 00 00 00 00 00 00 35 00 00 00
+ 04 00 00 00 40 00 00 00 00 00 00 00 d0 00 00 00
+ 24 00 00 00 06 00 00 00 04 00 00 00 04 00 00 00
+ 0c 00 00 00 2d 00 00 00 02 00 00 00 00 00 00 00
+ 00 00 00 00 68 00 00 00 50 00 00 00 01 00 00 00
+ 03 00 00 00 04 00 00 00 10 00 00 00
+
@@ -0,0 +1,3 @@
+Error: .text holds pc-relative addresses or indirect jumps that cannot be relocated
+One or more errors encountered during translation operation.
+
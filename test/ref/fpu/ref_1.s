@@ -0,0 +1,18 @@
+1100010000010101
+0110000010000000
+0111110001111100
+00001000000001001010010000000111
+0111000001111110
+00010000000000010010000010000111
+1110000001000100
+1110000001111110
+0011110011100000
+00000000010001001011010000000111
+0011000011111110
+1010010000000100
+1011111110000010
+00000000000100010011011000100111
+00000000001100010111000011010011
+00100010001100010111000011000011
+0100000011000000
+
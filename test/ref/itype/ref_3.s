@@ -0,0 +1,20 @@
+0100000010000010
+0101111111111110
+0100010010100010
+00000000010000010010000000000011
+00010000000000010010001010000011
+00000000011000010010001010000011
+11111111110000010010001010000011
+0111000100000001
+0110000101111101
+0001000100000001
+0000000101000001
+00100000000000010000000100010011
+00000010100000010000000100010011
+0000000001000000
+0001111111111100
+01000000000000010000010000010011
+00000000100000010000001010010011
+00000000000000010000010000010011
+00000000011000010000010000010011
+
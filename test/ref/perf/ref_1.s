@@ -0,0 +1,136 @@
+in/perf/input_1.s: 129 instructions, events per instruction
+phase cycles instructions branch-misses L1D-misses LLC-misses
+parse # # # # #
+classify # # # # #
+relocate # # # # #
+write # # # # #
+total # # # # #
+00000000011100110000001010110011
+1100110001111101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+1111000010000001
+1000000010000010
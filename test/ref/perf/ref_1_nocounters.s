@@ -0,0 +1,130 @@
+Warning: no hardware counters (#), check /proc/sys/kernel/perf_event_paranoid or the container's seccomp profile
+00000000011100110000001010110011
+1100110001111101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+1111000010000001
+1000000010000010
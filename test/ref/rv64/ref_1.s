@@ -0,0 +1,27 @@
+00000000100000000000000011101111
+0110000010000000
+0111110001111100
+0011001010000001
+0010001010000001
+1011111111110101
+00010000000001001011010000000011
+00000000010001001011010000000011
+0111000011111110
+00000000100000010011000000000011
+00100000000000010011000010000011
+1110010000000100
+1110000000000110
+1111111110000010
+00000000000100010011011000100011
+00000000000100110000001010011011
+00000000000100000000000000011011
+00000010000000101000001010011011
+1001110000100101
+1001111110011001
+00000000101001001000010000111011
+00000000100100101000001010111011
+0001001010100010
+1001010001111101
+1001000010000101
+0100000011000000
+
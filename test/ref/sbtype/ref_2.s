@@ -0,0 +1,66 @@
+1100000001001001
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+1000000010000010
@@ -0,0 +1,129 @@
+00000000011100110000001010110011
+1100110001111101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+1111000010000001
+1000000010000010
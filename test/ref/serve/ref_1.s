@@ -0,0 +1,64 @@
+1010010011110101
+0011111111111101
+0000010000000101
+1010100010101001
+0000010000000101
+0000010000000101
+1100000000001101
+0000010000000101
+0000010000000101
+0000010000000101
+1010101011010101
+0000010000000101
+0011011111100101
+1100110001011001
+1100100000100101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+1010001010011101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+1100100000010101
+1100110000001001
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+1101010001111101
+0011111101011101
+0000010000000101
+0011111101001101
+0000010000000101
+0000010000000101
+0000010000000101
+1100000000000001
+0000010000000101
+0000010000000101
+0000010000000101
+0011011101001101
+0000010000000101
+0000010000000101
+0000010000000101
+1101000001111001
+0000010000000101
+0000010000000101
+1111100001010101
+1111010001011101
+0000010000000101
+0000010000000101
+0000010000000101
+0011011101101001
+0011011101100001
+0000010000000101
+0000010000000101
+1010101001001001
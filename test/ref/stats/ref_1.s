@@ -0,0 +1,67 @@
+{"input":"in/stats/input_1.s","instructions":66,"bytes_in":264,"bytes_out":132,"ratio":0.5000,"relocated_branches":1,"seconds":{"parse":#,"classify":#,"relocate":#,"write":#,"total":#},"instypes":{"unknown":0,"I":65,"U":0,"S":0,"R":0,"SB":1,"UJ":0},"ctypes":{"none":0,"c.add":0,"c.mv":0,"c.jr":1,"c.jalr":0,"c.li":0,"c.lui":0,"c.addi":64,"c.slli":0,"c.lw":0,"c.sw":0,"c.and":0,"c.or":0,"c.xor":0,"c.sub":0,"c.beqz":1,"c.bnez":0,"c.srli":0,"c.srai":0,"c.andi":0,"c.j":0,"c.jal":0,"c.lwsp":0,"c.swsp":0,"c.addi16sp":0,"c.addi4spn":0,"c.ld":0,"c.sd":0,"c.ldsp":0,"c.sdsp":0,"c.addiw":0,"c.addw":0,"c.subw":0,"c.flw":0,"c.fsw":0,"c.flwsp":0,"c.fswsp":0,"c.fld":0,"c.fsd":0,"c.fldsp":0,"c.fsdsp":0,"c.lbu":0,"c.lhu":0,"c.lh":0,"c.sb":0,"c.sh":0,"c.zext.b":0,"c.sext.b":0,"c.zext.h":0,"c.sext.h":0,"c.zext.w":0,"c.not":0,"c.mul":0,"cm.push":0,"cm.pop":0,"cm.popret":0,"cm.mvsa01":0,"folded":0},"peak_rss_kib":#}
+1100000001001001
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+0000010000000101
+1000000010000010
@@ -0,0 +1,7 @@
+1100000000000110
+1101111110000010
+1101111000100110
+00010000000100010010000000100011
+11111110000100010010111000100011
+00000000000100010010000100100011
+
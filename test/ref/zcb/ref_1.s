@@ -0,0 +1,22 @@
+1010100000011101
+1000000011100000
+00000000010001001100010000000011
+00000000000001001100001010000011
+1000010110101000
+1000011011010000
+00000000000101101001011000000011
+00000000000001001000010000000011
+1000101111011000
+1000110010100000
+00000000100001001001000110100011
+1001110001100001
+1000100001111101
+1001110011100101
+1001110101101101
+1001110111101001
+1001111001110101
+11111111111101101100011000010011
+1001111011011001
+00000010110101110000011010110011
+00000010011000101000001010110011
+
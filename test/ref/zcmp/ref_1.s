@@ -0,0 +1,16 @@
+1010000000001101
+00000000101101010000110101100011
+1011100001100010
+1010110000100110
+1011100001000110
+0001000101000001
+1100010000100010
+00000000000001010000010000010011
+00000000000001011000010000010011
+1011101001010010
+0100000010110010
+0000000101000001
+1000000010000010
+1011111001110010
+00000000011100110000001010110011
+
@@ -0,0 +1,68 @@
+import os
+import resource
+import subprocess
+import sys
+import time
+
+# Scaling test: the full testcase is repeated until the stream reaches each size.
+# Every copy of the block is self-contained (its only branch stays inside the block),
+# so the expected output is the reference output repeated the same number of times.
+SIZES = [1000, 10000, 100000, 1000000, 10000000]
+
+TRANSLATOR = '../translator'
+BLOCK_IN = 'in/full/input_1.s'
+BLOCK_REF = 'ref/full/ref_1.s'
+
+
+def read_lines(fname):
+    with open(fname, 'r') as f:
+        return [l.strip() for l in f.readlines() if l.strip() != ""]
+
+
+def peak_rss_kib():
+    return resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+
+
+def run(size, block_in, block_ref):
+    copies = (size + len(block_in) - 1) // len(block_in)
+    in_fname = f'out/scale/input_{size}.s'
+    out_fname = f'out/scale/output_{size}.s'
+    with open(in_fname, 'w') as f:
+        f.write(('\n'.join(block_in) + '\n') * copies)
+    start = time.monotonic()
+    subprocess.run([TRANSLATOR, in_fname, out_fname], stdout=subprocess.DEVNULL, check=True)
+    elapsed = time.monotonic() - start
+    with open(out_fname, 'r') as out_f:
+        ok = True
+        count = 0
+        for line in out_f:
+            line = line.strip()
+            if line == "":
+                continue
+            if count >= copies * len(block_ref) or line != block_ref[count % len(block_ref)]:
+                ok = False
+                break
+            count += 1
+        ok = ok and count == copies * len(block_ref)
+    os.remove(in_fname)
+    os.remove(out_fname)
+    return copies * len(block_in), ok, elapsed
+
+
+def main():
+    sizes = [int(s) for s in sys.argv[1:]] or SIZES
+    block_in = read_lines(BLOCK_IN)
+    block_ref = read_lines(BLOCK_REF)
+    os.makedirs('out/scale', exist_ok=True)
+    passed = 1
+    print(f'{"instructions":>12} {"result":>6} {"seconds":>9} {"peak KiB":>10}')
+    for size in sizes:
+        count, ok, elapsed = run(size, block_in, block_ref)
+        passed &= ok
+        # ru_maxrss of children only ever grows, sizes are run in increasing order
+        print(f'{count:>12} {"ok" if ok else "FAIL":>6} {elapsed:>9.3f} {peak_rss_kib():>10}')
+    sys.exit(0 if passed else 1)
+
+
+if __name__ == '__main__':
+    main()
@@ -1,15 +1,15 @@
+import glob
 import json
 import os
 import sys
 
 # {test_type : number of testcases}
-TESTS = {'rtype': 2, 'itype': 2, 'stype': 2, 'sbtype': 1, 'utype': 2, 'ujtype': 1, 'full': 1}
+TESTS = {'rtype': 2, 'itype': 3, 'stype': 3, 'sbtype': 3, 'utype': 2, 'ujtype': 1, 'full': 1, 'bin': 1, 'elf': 1, 'elfout': 3, 'parallel': 1, 'pipeline': 1, 'lib': 1, 'serve': 1, 'batch': 1, 'stats': 1, 'perf': 1, 'decompress': 1, 'rv64': 1, 'fpu': 1, 'zcb': 1, 'zcmp': 1}
 
 results = {}
 
 
-def check_content(out_f, ref_f):
-    out_lines = [l.strip() for l in out_f.readlines() if l.strip() != ""]
+def check_content(out_lines, ref_f):
     ref_lines = [l.strip() for l in ref_f.readlines() if l.strip() != ""]
     if (len(out_lines) != len(ref_lines)):
         return 0
@@ -39,7 +39,12 @@ for idx, name in enumerate(TESTS):
                     open(ref_fname, 'r') as ref_f, \
                     open(mem_fname, 'r') as mem_f:
                 mem_check = mem_check & check_mem(mem_f)
-                results[f'({name}){idx + 1}-{tidx}'] = check_content(out_f, ref_f)
+                out_lines = [l.strip() for l in out_f.readlines() if l.strip() != ""]
+                results[f'({name}){idx + 1}-{tidx}'] = check_content(out_lines, ref_f)
+                # ref_N_<host>.s: another output that is right where the host lacks something, e.g. perf counters
+                for alt_fname in sorted(glob.glob(f'ref/{name}/ref_{tidx}_*.s')):
+                    with open(alt_fname, 'r') as alt_f:
+                        results[f'({name}){idx + 1}-{tidx}'] |= check_content(out_lines, alt_f)
         except FileNotFoundError:
             results[f'({name}){idx + 1}-{tidx}'] = 0
 results[f'memory check'] = mem_check
@@ -11,21 +11,46 @@
 #include <string.h>
 
 #include "src/compression.h"
+#include "src/decompression.h"
+#include "src/elf.h"
+#include "src/parallel.h"
+#include "src/perf.h"
+#include "src/pipeline.h"
+#include "src/server.h"
+#include "src/stats.h"
 #include "src/utils.h"
 
 #include "translator.h"
 
+/* Jobs that run at the same time with --serve and no -j */
+#define SERVE_WORKERS 4
+
+/* One input / output pair of a batch, and what became of it */
+typedef struct BatchFile {
+	const char *input;
+	const char *output;
+	int err;
+	/* Everything the translation printed, NULL when it printed nothing */
+	char *messages;
+} BatchFile;
+
+typedef struct Batch {
+	BatchFile *files;
+	size_t count;
+	const TranslateOptions *options;
+} Batch;
+
 /*check if file can be correctly opened */
-static int open_files(FILE **input, FILE **output, const char *input_name, const char *output_name) {
-	*input = fopen(input_name, "r");
+static int open_files(FILE **input, FILE **output, const char *input_name, const char *output_name, FILE *messages) {
+	*input = fopen(input_name, "rb");
 	if (!*input) { /* open input file failed */
-		printf("Error: unable to open input file: %s\n", input_name);
+		fprintf(messages, "Error: unable to open input file: %s\n", input_name);
 		return -1;
 	}
 
 	*output = fopen(output_name, "w");
 	if (!*output) { /* open output file failed */
-		printf("Error: unable to open output file: %s\n", output_name);
+		fprintf(messages, "Error: unable to open output file: %s\n", output_name);
 		fclose(*input);
 		return -1;
 	}
@@ -38,51 +63,500 @@ static int close_files(FILE **input, FILE **output) {
 	return 0;
 }
 
+static void print_usage(FILE *messages) {
+	fprintf(messages, "Usage:\n");
+	fprintf(messages, "Run program with translator [options] <input file> <output file>\n"); /* print the correct usage of the program */
+	fprintf(messages, "Or for many files with translator [options] <input file> <output file> <input file> <output file> ...\n");
+	fprintf(messages, "Or with translator [options] --batch <manifest>, one \"<input file> <output file>\" per line of manifest\n");
+	fprintf(messages, "Or keep it running with translator [-j N] --serve <socket> and use translator-client instead\n");
+	fprintf(messages, "Options:\n");
+	fprintf(messages, "  --input=text|bin|elf  Format of the input file (default: ELF by magic number, bin by .bin suffix, text otherwise)\n");
+	fprintf(messages, "  --output=text|bin|elf Format of the output file (default: text), elf rewrites an ELF input with its .text compressed\n");
+	fprintf(messages, "  --pipeline            Read, compress and write at the same time on three threads, for text and bin files,\n");
+	fprintf(messages, "                        memory still grows with the input as without it\n");
+	fprintf(messages, "  --stats=json          Print timings, counts and sizes of every translation as one JSON line to stderr\n");
+	fprintf(messages, "                        (to the output of translator-client with --serve), phases run one after another\n");
+	fprintf(messages, "  --perf-counters       Print cycles, instructions, branch and cache misses per instruction of every phase to stderr,\n");
+	fprintf(messages, "                        into the JSON line with --stats=json, phases run one after another\n");
+	fprintf(messages, "  --xlen=32|64          Compress for RV32C (default) or RV64C: c.ld, c.sd, c.ldsp, c.sdsp, c.addiw, c.addw and c.subw,\n");
+	fprintf(messages, "                        shifts by up to 63 and no c.jal, for text and bin files\n");
+	fprintf(messages, "  --march=ISA           Compress for an ISA string such as rv32imafdc or rv64gc, with C and an I or G base: its XLEN,\n");
+	fprintf(messages, "                        and with F or D (or G)\n");
+	fprintf(messages, "                        c.flw, c.fsw, c.flwsp, c.fswsp (RV32 only) and c.fld, c.fsd, c.fldsp, c.fsdsp\n");
+	fprintf(messages, "                        With _zcb (rv32imc_zcb) also c.lbu, c.lhu, c.lh, c.sb, c.sh, c.zext.b/h/w, c.sext.b/h, c.not, c.mul\n");
+	fprintf(messages, "                        With _zcmp (rv32imc_zcmp, not with D) also cm.push, cm.pop, cm.popret and cm.mvsa01 in place of\n");
+	fprintf(messages, "                        whole prologues, epilogues and argument moves, for text and bin output, without --pipeline\n");
+	fprintf(messages, "  --decompress          Expand compressed code back to 32-bit instructions with their original offsets,\n");
+	fprintf(messages, "                        the input holds 16-digit and 32-digit lines, or 16-bit and 32-bit parcels with --input=bin\n");
+	fprintf(messages, "  -j N                  Compress, relocate and write with N threads (default: 1), the output is the same for every N\n");
+	fprintf(messages, "                        With --serve, run N jobs at the same time (default: %d)\n", SERVE_WORKERS);
+	fprintf(messages, "                        With several files, translate N files at the same time (default: every processor)\n");
+	fprintf(messages, "  --batch <manifest>    Translate every pair of files listed in manifest, one status line per pair\n");
+	fprintf(messages, "  --serve <socket>      Wait for jobs of translator-client on a Unix domain socket\n");
+}
+
 static void print_usage_and_exit() {
-	printf("Usage:\n");
-	printf("Run program with translator <input file> <output file>\n"); /* print the correct usage of the program */
+	print_usage(stdout);
 	exit(0);
 }
 
+/* Whether the multi-letter extension at name (after its underscore) is extension, with or without a version */
+static int is_extension(const char *name, const char *extension) {
+	size_t length = strlen(extension);
+	return strncmp(name + 1, extension, length) == 0 && (name[length + 1] == '\0' || name[length + 1] == '_' || (name[length + 1] >= '0' && name[length + 1] <= '9'));
+}
+
+/* Instruction set of an ISA string such as rv32imafdc or rv64gc_zcb, -1 when it is not one or has no C to compress for */
+static long parse_march(const char *march) {
+	unsigned long isa;
+	const char *letter, *name;
+	int compressed = 0;
+	/* 1. XLEN, then the base integer set i or g. RV32E and RV64E are left out: they only have x0 ~ x15, and the
+	 *    translator keeps every register of its input */
+	if (strncmp(march, "rv32", 4) == 0) isa = 0;
+	else if (strncmp(march, "rv64", 4) == 0) isa = ISA_RV64;
+	else return -1;
+	if (march[4] != 'i' && march[4] != 'g') return -1;
+	/* 2. Single-letter extensions up to the first multi-letter one, g stands for imafd and d needs f */
+	for (letter = march + 4; *letter != '\0' && *letter != '_'; ++letter) {
+		if (*letter == 'f') isa |= ISA_F;
+		else if (*letter == 'd' || *letter == 'g') isa |= ISA_F | ISA_D;
+		else if (*letter == 'c') compressed = 1;
+	}
+	/* 3. Extensions after underscores, with or without a version, others are left out */
+	for (name = letter; *name == '_'; name += strcspn(name + 1, "_") + 1) {
+		if (is_extension(name, "zcb")) isa |= ISA_ZCB;
+		else if (is_extension(name, "zcmp")) isa |= ISA_ZCMP;
+		else if (is_extension(name, "f")) isa |= ISA_F;
+		else if (is_extension(name, "d")) isa |= ISA_F | ISA_D;
+		else if (is_extension(name, "c")) compressed = 1;
+	}
+	if (!compressed) return -1;
+	/* 4. Zcmp takes the encodings of c.fld, c.fsd, c.fldsp and c.fsdsp */
+	if ((isa & ISA_ZCMP) && (isa & ISA_D)) return -1;
+	return (long) isa;
+}
+
+/* Read the options before the file names, returns the index of the first file name or -1. threads stays 0 without -j */
+static int parse_options(int argc, char **argv, int first, TranslateOptions *options, const char **serve, const char **batch) {
+	int i;
+	options->input = INPUT_AUTO;
+	options->output = OUTPUT_TEXT;
+	options->threads = 0;
+	options->pipeline = 0;
+	options->stats = 0;
+	options->counters = 0;
+	options->decompress = 0;
+	options->isa = 0;
+	for (i = first; i < argc && argv[i][0] == '-'; ++i) { /* options come before the file names */
+		if (strncmp(argv[i], "-j", 2) == 0) {
+			/* Thread count, either "-j N" or "-jN" */
+			const char *count = argv[i][2] != '\0' ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+			char *end;
+			long threads = strtol(count, &end, 10);
+			if (*count == '\0' || *end != '\0' || threads < 1 || threads > MAX_THREADS) return -1;
+			options->threads = (int) threads;
+		} else if (strcmp(argv[i], "--input=text") == 0) options->input = INPUT_TEXT;
+		else if (strcmp(argv[i], "--input=bin") == 0) options->input = INPUT_BINARY;
+		else if (strcmp(argv[i], "--input=elf") == 0) options->input = INPUT_ELF;
+		else if (strcmp(argv[i], "--output=text") == 0) options->output = OUTPUT_TEXT;
+		else if (strcmp(argv[i], "--output=bin") == 0) options->output = OUTPUT_BINARY;
+		else if (strcmp(argv[i], "--output=elf") == 0) options->output = OUTPUT_ELF;
+		else if (strcmp(argv[i], "--pipeline") == 0) options->pipeline = 1;
+		else if (strcmp(argv[i], "--stats=json") == 0) options->stats = 1;
+		else if (strcmp(argv[i], "--perf-counters") == 0) options->counters = 1;
+		else if (strcmp(argv[i], "--decompress") == 0) options->decompress = 1;
+		else if (strcmp(argv[i], "--xlen=32") == 0) options->isa &= ~ISA_RV64;
+		else if (strcmp(argv[i], "--xlen=64") == 0) options->isa |= ISA_RV64;
+		else if (strncmp(argv[i], "--march=", 8) == 0 && parse_march(argv[i] + 8) >= 0) options->isa = (unsigned int) parse_march(argv[i] + 8);
+		else if (strcmp(argv[i], "--serve") == 0 && serve != NULL && i + 1 < argc) *serve = argv[++i];
+		else if (strcmp(argv[i], "--batch") == 0 && batch != NULL && i + 1 < argc) *batch = argv[++i];
+		else return -1;
+	}
+	return i;
+}
+
+/* Decide the input format from the first byte and the file name */
+static InputFormat detect_format(FILE *input, const char *input_name) {
+	size_t length = strlen(input_name);
+	int first = getc(input);
+	if (first != EOF) ungetc(first, input);
+	if (first == 0x7F) return INPUT_ELF; /* ELF magic number, text files start with '0', '1' or blanks */
+	if (length >= 4 && strcmp(input_name + length - 4, ".bin") == 0) return INPUT_BINARY;
+	return INPUT_TEXT;
+}
+
+
+/* Write the translated instructions in the requested format */
+static int write_output(FILE *output, OutputFormat format, const MappedFile *elf, const ElfSection *text, const Program *program) {
+	switch (format) {
+		case OUTPUT_ELF:
+			return writeToElf(output, elf, text, program) != 0;
+		case OUTPUT_BINARY:
+			return writeToBinary(output, program) != 0;
+		default:
+			return writeToFile(output, program) != 0;
+	}
+}
 
 /*Run the translator 
 */
 int translate(const char *in, const char *out) {
-	FILE *input, *output;
+	TranslateOptions options;
+	options.input = INPUT_AUTO;
+	options.output = OUTPUT_TEXT;
+	options.threads = 1;
+	options.pipeline = 0;
+	options.stats = 0;
+	options.counters = 0;
+	options.decompress = 0;
+	options.isa = 0;
+	return translateWithOptions(in, out, &options);
+}
+
+/* What --stats and --perf-counters measure during one translation */
+typedef struct Measurement {
+	const TranslateOptions *options;
+	Stats stats;
+	PerfCounters counters;
+	double mark;
+	/* Whether anything is measured at all */
+	int on;
+} Measurement;
+
+/* End a phase of --stats and --perf-counters */
+static void end_phase(Measurement *measurement, Phase phase) {
+	if (!measurement->on) return;
+	if (measurement->options->stats) measurement->stats.seconds[phase] = lapSeconds(&measurement->mark);
+	if (measurement->counters.mask != 0) lapCounters(&measurement->counters, &measurement->stats, phase);
+}
+
+/* Compress the instructions and relocate the branches, errors are printed to messages */
+static int compress_program(Program *program, FILE *messages, Measurement *measurement) {
+	int err = primaryCompression(program);
+	if (err == 2) {
+		fprintf(messages, "Error: unknown instruction %lu\n", (unsigned long) program->invalid + 1);
+		return 1;
+	} else if (err != 0) {
+		fprintf(messages, "Error: out of memory while compressing instructions\n");
+		return 1;
+	}
+	end_phase(measurement, PHASE_CLASSIFY);
+	if (relaxBranches(program) != 0 || confirmAddress(program) != 0) { /* Compress branches that come within reach, then set correct offsets */
+		fprintf(messages, "Error: out of memory while relocating branches\n");
+		return 1;
+	}
+	end_phase(measurement, PHASE_RELOCATE);
+	return 0;
+}
+
+/* Expand compressed instructions and give the branches their old offsets back (--decompress) */
+static int expand_program(Program *program, FILE *messages, Measurement *measurement) {
+	/* The addresses in the compressed code are only known before the expansion */
+	uint32_t *addresses = parcelAddresses(program);
 	int err = 0;
-	if (in) { /* correct input file name */
-		if (open_files(&input, &output, in, out) != 0) exit(1);
-		/* Test functions over here! */
-		{
-			/* Read in the original file */
-			Instruction **originalFile = readFromFile(input);
-			/* Compress instructions */
-			Compressed **compressed = primaryCompression((const Instruction **) originalFile);
-			/* Set correct offsets */
-			confirmAddress(originalFile, compressed);
+	if (addresses == NULL) {
+		fprintf(messages, "Error: out of memory while relocating branches\n");
+		return 1;
+	}
+	err = expandParcels(program);
+	if (err == 2) {
+		fprintf(messages, "Error: unknown compressed instruction %lu\n", (unsigned long) program->invalid + 1);
+		err = 1;
+	} else if (err != 0) {
+		fprintf(messages, "Error: out of memory while expanding instructions\n");
+	} else {
+		end_phase(measurement, PHASE_CLASSIFY);
+		err = restoreBranches(program, addresses);
+		if (err == 3) fprintf(messages, "Error: instruction %lu cannot reach its target once expanded\n", (unsigned long) program->invalid + 1);
+		else if (err != 0) fprintf(messages, "Error: out of memory while relocating branches\n");
+		else end_phase(measurement, PHASE_RELOCATE);
+		err = err != 0;
+	}
+	free(addresses);
+	return err;
+}
+
+/* Translate between two open files, errors are printed to messages and --stats / --perf-counters to report */
+static int translate_files(FILE *input, FILE *output, const char *in, const TranslateOptions *options, FILE *messages, FILE *report) {
+	InputFormat format = options->input;
+	Program *originalFile = NULL;
+	MappedFile elf;
+	ElfSection text;
+	Measurement measurement;
+	int err = 0;
+	elf.data = NULL;
+	measurement.options = options;
+	measurement.on = options->stats || options->counters;
+	measurement.mark = 0;
+	measurement.stats.counterMask = measurement.counters.mask = 0;
+	if (options->stats) lapSeconds(&measurement.mark); /* the clock is only read when asked for */
+	if (options->counters) openCounters(&measurement.counters, report);
+	if (format == INPUT_AUTO) format = detect_format(input, in);
+	/* Read in the original file */
+	if (options->decompress && (format == INPUT_ELF || options->output == OUTPUT_ELF)) {
+		fprintf(messages, "Error: --decompress needs text or bin files\n");
+	} else if ((options->isa & ISA_ZCMP) && options->output == OUTPUT_ELF) {
+		fprintf(messages, "Error: Zcmp needs text or bin output\n");
+	} else if (options->pipeline && !measurement.on && !options->decompress && !(options->isa & ISA_ZCMP) && format != INPUT_ELF && options->output != OUTPUT_ELF) {
+		/* Everything happens while the file is read, ELF files need the whole image and Zcmp runs the whole program, they take the usual way */
+		err = translateStream(input, format == INPUT_BINARY, output, options->output == OUTPUT_BINARY, options->isa);
+		if (err == 3) fprintf(messages, "Error: unknown instruction in the input\n");
+		return err != 0;
+	} else if (options->output == OUTPUT_ELF) {
+		/* The whole ELF file is kept around to be rewritten */
+		if (format != INPUT_ELF) fprintf(messages, "Error: ELF output needs ELF input\n");
+		else if (loadElf(input, &elf, &text) == 0) originalFile = readFromWords(elf.data + text.offset, text.size);
+		/* Relocated instructions keep 32 bits, addresses that cannot be relocated refuse the file */
+		if (originalFile != NULL && (err = pinElfReferences(&elf, &text, originalFile)) != 0) {
+			if (err == 2) fprintf(messages, "Error: .text holds pc-relative addresses or indirect jumps that cannot be relocated\n");
+			else fprintf(messages, "Error: out of memory while reading relocations\n");
+			clearAll(originalFile);
+			originalFile = NULL;
+		}
+	} else if (format == INPUT_BINARY) {
+		/* Compressed code is a stream of 16-bit and 32-bit instructions */
+		originalFile = options->decompress ? readParcelsFromBinary(input) : readFromBinary(input);
+	} else if (format == INPUT_ELF) {
+		originalFile = readFromElf(input);
+	} else {
+		originalFile = readFromFile(input);
+	}
+	end_phase(&measurement, PHASE_PARSE);
+	if (originalFile == NULL) {
+		err = 1;
+	} else {
+		/* Compress instructions, or expand them back */
+		originalFile->threads = options->threads;
+		originalFile->isa = options->isa;
+		err = options->decompress ? expand_program(originalFile, messages, &measurement) : compress_program(originalFile, messages, &measurement);
+		if (!err) {
 			/* Write to files */
-			writeToFile(output, originalFile, compressed);
-			/* Free all space allocated on heap */
-			clearAll(originalFile, compressed);
+			err = write_output(output, options->output, &elf, &text, originalFile);
+			end_phase(&measurement, PHASE_WRITE);
 		}
-		/* Done testing */
+		/* Report what has been done, counting is kept out of the timings */
+		if (measurement.on && !err) {
+			countProgram(&measurement.stats, originalFile);
+			if (options->stats) writeStats(report, &measurement.stats, in);
+			else if (measurement.counters.mask != 0) writeCounters(report, &measurement.stats, in);
+		}
+		/* Free all space allocated on heap */
+		clearAll(originalFile);
+	}
+	if (elf.data != NULL) unmapFile(&elf);
+	closeCounters(&measurement.counters);
+	return err;
+}
+
+/* Open, translate and close one pair of files, errors are printed to messages */
+static int translate_pair(const char *in, const char *out, const TranslateOptions *options, FILE *messages, FILE *report) {
+	FILE *input, *output;
+	int err = 0;
+	if (in) { /* correct input file name */
+		if (open_files(&input, &output, in, out, messages) != 0) return 1;
+		err = translate_files(input, output, in, options, messages, report);
 		close_files(&input, &output);
 	}
 	return err;
 }
 
+int translateWithOptions(const char *in, const char *out, const TranslateOptions *options) {
+	return translate_pair(in, out, options, stdout, stderr);
+}
+
+/* Read the whole of a (small) text file, NULL when it cannot be read */
+static char *read_text(const char *name) {
+	FILE *file = fopen(name, "rb");
+	char *text = NULL, *grown;
+	size_t used = 0, size = 0, got;
+	if (file == NULL) return NULL;
+	do {
+		if (used + 1 >= size) {
+			size = size == 0 ? 4096 : 2 * size;
+			grown = realloc(text, size);
+			if (grown == NULL) {
+				free(text);
+				fclose(file);
+				return NULL;
+			}
+			text = grown;
+		}
+		got = fread(text + used, 1, size - used - 1, file);
+		used += got;
+	} while (got != 0);
+	text[used] = '\0';
+	fclose(file);
+	return text;
+}
+
+/* Split a manifest into pairs: two names per line separated by blanks, '#' starts a comment line.
+   NULL when memory runs out or a line is malformed (bad_line) */
+static BatchFile *read_manifest(char *text, size_t *count, int *bad_line) {
+	size_t size = 64, line = 0;
+	BatchFile *files = malloc(sizeof(BatchFile) * size), *grown;
+	char *cursor = text;
+	*count = 0;
+	*bad_line = 0;
+	while (files != NULL && *cursor != '\0') {
+		char *names[3];
+		char *end = strchr(cursor, '\n'), *next = end != NULL ? end + 1 : cursor + strlen(cursor);
+		int found = 0;
+		++line;
+		if (end != NULL) *end = '\0';
+		/* 1. Up to three words before a comment, a third one is an error */
+		while (*cursor != '\0' && *cursor != '#' && found < 3) {
+			while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r') *cursor++ = '\0';
+			if (*cursor == '\0' || *cursor == '#') break;
+			names[found++] = cursor;
+			while (*cursor != '\0' && *cursor != ' ' && *cursor != '\t' && *cursor != '\r') ++cursor;
+		}
+		if (found == 1 || found == 3) {
+			*bad_line = (int) line;
+			free(files);
+			return NULL;
+		}
+		/* 2. Keep the pair */
+		if (found == 2) {
+			if (*count == size) {
+				size *= 2;
+				grown = realloc(files, sizeof(BatchFile) * size);
+				if (grown == NULL) free(files);
+				files = grown;
+				if (files == NULL) break;
+			}
+			files[*count].input = names[0];
+			files[(*count)++].output = names[1];
+		}
+		cursor = next;
+	}
+	return files;
+}
+
+static void run_batch_file(void *context, size_t task, int worker) {
+	Batch *batch = context;
+	BatchFile *file = &batch->files[task];
+	FILE *messages = tmpfile();
+	long size;
+	(void) worker;
+	/* 1. Messages of files running at the same time must not mix, each one gets its own */
+	file->messages = NULL;
+	file->err = translate_pair(file->input, file->output, batch->options, messages != NULL ? messages : stdout, stderr);
+	if (messages == NULL) return;
+	/* 2. Keep them for the report */
+	size = ftell(messages);
+	if (size > 0 && (file->messages = malloc((size_t) size + 1)) != NULL) {
+		rewind(messages);
+		file->messages[fread(file->messages, 1, (size_t) size, messages)] = '\0';
+	}
+	fclose(messages);
+}
+
+/* Translate every pair, then report each of them in order. Returns the number that failed */
+static size_t translate_batch(BatchFile *files, size_t count, const TranslateOptions *options, int workers) {
+	Batch batch;
+	size_t i, failed = 0;
+	batch.files = files;
+	batch.count = count;
+	batch.options = options;
+	/* Whole files are spread over the workers, one thread each */
+	parallelTasks(workers, count, run_batch_file, &batch);
+	for (i = 0; i < count; ++i) {
+		printf("%s: %s -> %s\n", files[i].err ? "error" : "ok", files[i].input, files[i].output);
+		if (files[i].messages != NULL) {
+			char *line = strtok(files[i].messages, "\n");
+			for (; line != NULL; line = strtok(NULL, "\n")) printf("  %s\n", line);
+			free(files[i].messages);
+		}
+		failed += files[i].err != 0;
+	}
+	printf("Translated %lu of %lu files.\n", (unsigned long) (count - failed), (unsigned long) count);
+	return failed;
+}
+
+/* --batch, or more than one pair on the command line. Returns whether anything failed */
+static int run_batch(char **names, int name_count, const char *manifest, TranslateOptions *options) {
+	BatchFile *files;
+	char *text = NULL;
+	size_t count = (size_t) name_count / 2, k;
+	int workers = options->threads != 0 ? options->threads : onlineProcessors(), bad_line = 0, err = 1;
+	/* 1. The pairs, from the manifest or from the command line */
+	if (manifest != NULL) {
+		text = read_text(manifest);
+		if (text == NULL) {
+			printf("Error: unable to open manifest: %s\n", manifest);
+			return 1;
+		}
+		files = read_manifest(text, &count, &bad_line);
+	} else {
+		files = malloc(sizeof(BatchFile) * count);
+		for (k = 0; files != NULL && k < count; ++k) {
+			files[k].input = names[2 * k];
+			files[k].output = names[2 * k + 1];
+		}
+	}
+	/* 2. The files are what runs in parallel, each one is translated on a single thread */
+	if (bad_line != 0) printf("Error: line %d of %s is not \"<input file> <output file>\"\n", bad_line, manifest);
+	else if (files == NULL) printf("Error: out of memory\n");
+	else {
+		options->threads = 1;
+		err = translate_batch(files, count, options, workers) != 0;
+	}
+	free(files);
+	free(text);
+	return err;
+}
+
+/* A job of translator-client: the options of its command line, its files and its standard output */
+static int serve_job(int argc, char **argv, const char *name, FILE *in, FILE *out, FILE *messages) {
+	TranslateOptions options;
+	int err;
+	/* Only options come along, the file names are already open */
+	if (parse_options(argc, argv, 0, &options, NULL, NULL) != argc) {
+		print_usage(messages);
+		return 2;
+	}
+	if (options.threads == 0) options.threads = 1;
+	err = translate_files(in, out, name, &options, messages, messages);
+	if (err) fprintf(messages, "One or more errors encountered during translation operation.\n");
+	else fprintf(messages, "Translation process completed successfully.\n");
+	return err;
+}
+
 /* main func */
 int main(int argc, char **argv) {
 	char *input_fname, *output_fname;
-	int err;
+	const char *socket_path = NULL, *manifest = NULL;
+	TranslateOptions options;
+	int err, i;
+
+	i = parse_options(argc, argv, 1, &options, &socket_path, &manifest);
+	if (i < 0) print_usage_and_exit();
+
+	if (socket_path != NULL) { /* long-lived server, the jobs bring their own options and files */
+		if (argc - i != 0 || manifest != NULL || options.input != INPUT_AUTO || options.output != OUTPUT_TEXT || options.pipeline) print_usage_and_exit();
+		err = serve(socket_path, options.threads != 0 ? options.threads : SERVE_WORKERS, serve_job);
+		if (err) printf("Error: unable to serve on %s\n", socket_path);
+		return err != 0;
+	}
+
+	if (manifest != NULL || argc - i > 2) { /* many files, each one on a single thread */
+		if (manifest != NULL ? argc - i != 0 : (argc - i) % 2 != 0) print_usage_and_exit();
+		err = run_batch(argv + i, argc - i, manifest, &options);
+		if (err) printf("One or more errors encountered during translation operation.\n"); /* something wrong */
+		else
+			printf("Translation process completed successfully.\n"); /* correctly output */
+		return 0;
+	}
+	if (options.threads == 0) options.threads = 1;
 
-	if (argc != 3) /* need correct arguments */
+	if (argc - i != 2) /* need correct arguments */
 		print_usage_and_exit();
 
-	input_fname = argv[1];
-	output_fname = argv[2];
+	input_fname = argv[i];
+	output_fname = argv[i + 1];
 
-	err = translate(input_fname, output_fname);                                        /* main translation process */
+	err = translateWithOptions(input_fname, output_fname, &options);                   /* main translation process */
 	if (err) printf("One or more errors encountered during translation operation.\n"); /* something wrong */
 	else
 		printf("Translation process completed successfully.\n"); /* correctly output */
@@ -2,7 +2,50 @@
 #define TRANSLATOR_H
 
 
+/* Format of the input file */
+typedef enum InputFormat {
+	/* Decide from the content and the file name */
+	INPUT_AUTO = 0,
+	/* One 32-character line of '0' / '1' per instruction */
+	INPUT_TEXT,
+	/* Flat stream of little-endian 32-bit words */
+	INPUT_BINARY,
+	/* The .text section of an ELF32 file */
+	INPUT_ELF
+} InputFormat;
+
+/* Format of the output file */
+typedef enum OutputFormat {
+	/* One line of '0' / '1' per instruction */
+	OUTPUT_TEXT = 0,
+	/* Little-endian 16-bit and 32-bit instructions */
+	OUTPUT_BINARY,
+	/* The input ELF file with its .text compressed, only for ELF input */
+	OUTPUT_ELF
+} OutputFormat;
+
+typedef struct TranslateOptions {
+	/* Format of the input file */
+	InputFormat input;
+	/* Format of the output file */
+	OutputFormat output;
+	/* Number of threads for compression, relocation and text output (-j), 1 runs everything on the calling thread */
+	int threads;
+	/* Whether reading, compression and writing overlap (--pipeline), only for text and binary files */
+	int pipeline;
+	/* Whether timings, counts and sizes are reported as JSON (--stats=json), turns pipeline off */
+	int stats;
+	/* Whether hardware events of every phase are counted (--perf-counters), turns pipeline off */
+	int counters;
+	/* Whether compressed code is expanded back to 32-bit instructions (--decompress), text and binary files only */
+	int decompress;
+	/* Instruction set the code is compressed for (--xlen=64, --march=rv32imafdc), ISA_* flags of utils.h */
+	unsigned int isa;
+} TranslateOptions;
+
 int translate(const char*in, const char*out);
 
+int translateWithOptions(const char *in, const char *out, const TranslateOptions *options);
+
 
 #endif